@@ -61,13 +61,44 @@ typedef struct {
 
 	gboolean free_after_use;
 
+	/* the pool that the closure is returned to on release, if any */
+	struct _GPerlI11nClosurePool *pool;
+
+	/* created lazily when the callback is first invoked */
+	struct _GPerlI11nPerlPlan *plan;
+
+	/* set if a C function is handed to C instead of a closure */
+	gpointer native_func;
+	gpointer native_data;
+	GDestroyNotify native_destroy;
+
+	/* set if the callback is implemented by a native comparator */
+	struct _GPerlI11nComparator *comparator;
+
+	/* set if the callback natively calls the finish function of an async
+	 * operation and resolves the future with its results */
+	const struct _GPerlI11nFunctionEntry *finish;
+	SV *future;
+	/* ... or queues them for a bulk dispatcher instead */
+	struct _GPerlI11nAsyncBulk *bulk;
+	gint bulk_index;
+
+	/* queued invocations from other threads that still refer to the info;
+	 * releasing it is deferred until they have run. */
+	gint n_pins;
+	gboolean release_pending;
+
 	gpointer priv; /* perl context */
 } GPerlI11nPerlCallbackInfo;
 
+/* The data handed to generic_interface_init. */
 typedef struct {
-	GISignalInfo *interface;
-	SV *args_converter;
-} GPerlI11nPerlSignalInfo;
+	GIInterfaceInfo *info;
+	gchar *target_package;
+	/* whether to wait until INIT and then only hook up the vfuncs that
+	 * target_package implements */
+	gboolean defer;
+} GPerlI11nInterfaceData;
 
 typedef struct {
 	GICallableInfo *interface;
@@ -80,6 +111,9 @@ typedef struct {
 	gint destroy_pos;
 
 	SV *data_sv;
+
+	/* created lazily when the callback is first invoked from Perl */
+	struct _GPerlI11nCPlan *plan;
 } GPerlI11nCCallbackInfo;
 
 typedef struct {
@@ -87,6 +121,96 @@ typedef struct {
 	gint length_pos;
 } GPerlI11nArrayInfo;
 
+/* The parts of an invocation that depend only on the callable and not on the
+ * particular values passed to it.  Plans are computed once and then shared by
+ * all invocations of the callable, so they are never written to afterwards. */
+typedef struct {
+	GICallableInfo *interface;
+
+	gboolean is_function;
+	gboolean is_vfunc;
+	gboolean is_callback;
+	gboolean is_signal;
+
+	guint n_args;
+	GIArgInfo * arg_infos;
+	GITypeInfo * arg_types;
+
+	gboolean has_return_value;
+	ffi_type * return_type_ffi;
+	GITypeInfo return_type_info;
+	GITransfer return_type_transfer;
+} GPerlI11nPlan;
+
+/* The plan used when invoking Perl code. */
+typedef struct _GPerlI11nPerlPlan {
+	GPerlI11nPlan base;
+
+	GIDirection * directions;
+	GITransfer * transfers;
+	gboolean * is_caller_allocated;
+
+	/* The positions of the args that hold array lengths. */
+	guint n_length_args;
+	guint * length_arg_positions;
+
+	/* The number of in-out and out args and, derived from it, what the
+	 * Perl code is called with and expected to return. */
+	guint n_in_inout;
+	guint n_return_values;
+	I32 context;
+
+	gboolean may_return_null;
+
+	/* Whether an invocation can still run after its caller has returned,
+	 * given copies of the arg values. */
+	gboolean can_run_detached;
+
+	/* For signals: how the args are to be converted before they are
+	 * handed to the handler, if at all. */
+	struct _GPerlI11nArgsConversion *conversion;
+} GPerlI11nPerlPlan;
+
+/* The data handed to invoke_perl_signal_handler.  The plan is shared by all
+ * handlers connected to the signal. */
+typedef struct {
+	GISignalInfo *interface;
+	SV *args_converter;
+	GPerlI11nPerlPlan *plan;
+	/* the interpreter that args_converter belongs to */
+	gpointer priv;
+} GPerlI11nPerlSignalInfo;
+
+/* The plan used when invoking C code. */
+typedef struct _GPerlI11nCPlan {
+	GPerlI11nPlan base;
+
+	gboolean is_constructor;
+	gboolean is_method;
+	gboolean throws;
+	/* whether any arg is a callback; such calls cannot run on another
+	 * thread, see invoke_c_code_async */
+	gboolean takes_callback;
+	/* whether ownership of a non-basic value is passed to the callee;
+	 * such calls are not run in parallel, see invoke_c_code_parallel */
+	gboolean passes_ownership;
+
+	guint n_invoke_args;
+	guint n_nullable_args;
+	guint n_expected_args;
+
+	gboolean * is_automatic_arg;
+
+	guint constructor_offset;
+	guint method_offset;
+
+	/* The call interface only depends on the types of the args, so it is
+	 * prepared together with the plan. */
+	ffi_type ** arg_types_ffi;
+	ffi_cif cif;
+	gboolean cif_is_prepared;
+} GPerlI11nCPlan;
+
 /* The next three structs store information that the different marshallers
  * might need to communicate to each other.  This struct is the basis used for
  * invoking C and Perl code. */
@@ -104,6 +228,8 @@ typedef struct {
 	/* The current position under investigation in the list of typelib
 	 * args. */
 	guint current_pos;
+	/* Whether the caller left out the arg at current_pos. */
+	gboolean current_arg_is_omitted;
 
 	/* Information about the args from the typelib. */
 	GIArgInfo * arg_infos;
@@ -121,12 +247,17 @@ typedef struct {
 	GSList * array_infos;
 
 	GSList * free_after_call;
+
+	/* A future that is returned in addition to the regular results. */
+	SV * future;
 } GPerlI11nInvocationInfo;
 
 /* This struct is used when invoking C code. */
 typedef struct {
 	GPerlI11nInvocationInfo base;
 
+	const GPerlI11nCPlan *plan;
+
 	const gchar *target_package;
 	const gchar *target_namespace;
 	const gchar *target_function;
@@ -160,8 +291,65 @@ typedef struct {
 /* This struct is used when invoking Perl code. */
 typedef struct {
 	GPerlI11nInvocationInfo base;
+
+	const GPerlI11nPerlPlan *plan;
 } GPerlI11nPerlInvocationInfo;
 
+/* The kinds of members that find_member_index knows about. */
+typedef enum {
+	GPERL_I11N_MEMBER_METHOD,
+	GPERL_I11N_MEMBER_FIELD,
+	GPERL_I11N_MEMBER_VFUNC,
+	GPERL_I11N_MEMBER_SIGNAL,
+	GPERL_I11N_N_MEMBER_KINDS
+} GPerlI11nMemberKind;
+
+/* A resolved function together with its plan, as stored in the function
+ * cache. */
+typedef struct _GPerlI11nFunctionEntry {
+	GIFunctionInfo *info;
+	gpointer func_pointer;
+	GPerlI11nCPlan *plan;
+} GPerlI11nFunctionEntry;
+
+/* A C function that is wired in directly where a callback or signal handler is
+ * expected; see gperl-i11n-native.c.  All references are borrowed. */
+typedef struct {
+	GICallableInfo *info;
+	gboolean is_method;
+	gpointer func;
+	/* set if the function is a C callback that was handed to Perl */
+	GPerlI11nCCallbackInfo *wrapper;
+} GPerlI11nNativeCallable;
+
+/* The state of a bulk async dispatch; see gperl-i11n-invoke-c.c. */
+typedef struct _GPerlI11nAsyncBulk GPerlI11nAsyncBulk;
+
+/* Everything needed to wire up one vfunc of an object type. */
+typedef struct {
+	GIVFuncInfo *vfunc_info;
+	const gchar *name;
+	gchar *perl_method_name;
+	gint field_offset;
+	/* The callback type of the class struct member. */
+	GICallableInfo *field_interface_info;
+} GPerlI11nVFuncEntry;
+
+/* A fallback vfunc sub, chaining up to the C implementation found in the class
+ * struct of an implementer. */
+typedef struct {
+	gpointer klass;
+	gint field_offset;
+	const GPerlI11nCPlan *plan;
+} GPerlI11nFallbackVFunc;
+
+/* The vfuncs an object type declares, in the order of the typelib. */
+typedef struct {
+	GIObjectInfo *info;
+	guint n_vfuncs;
+	GPerlI11nVFuncEntry *vfuncs;
+} GPerlI11nVFuncTable;
+
 typedef enum {
 	GPERL_I11N_MEMORY_SCOPE_IRRELEVANT,
 	GPERL_I11N_MEMORY_SCOPE_TEMPORARY,
@@ -169,17 +357,52 @@ typedef enum {
 
 /* callbacks */
 static GPerlI11nPerlCallbackInfo * create_perl_callback_closure_for_named_sub (GIBaseInfo *cb_info, gchar *sub_name);
+static GPerlI11nPerlCallbackInfo * get_shared_perl_callback_closure_for_vfunc (GIBaseInfo *container_info, GICallableInfo *cb_info, const gchar *sub_name);
 static GPerlI11nPerlCallbackInfo * create_perl_callback_closure (GIBaseInfo *cb_info, SV *code);
 static void attach_perl_callback_data (GPerlI11nPerlCallbackInfo *info, SV *data);
 static void release_perl_callback (gpointer data);
+static void pin_perl_callback (GPerlI11nPerlCallbackInfo *info);
+static void unpin_perl_callback (GPerlI11nPerlCallbackInfo *info);
+static GHashTable * new_resolved_methods_table (void);
+static void clear_resolved_methods (GPerlI11nPerlCallbackInfo *info);
+static gboolean is_coalesced_sv (SV *sv);
+static gboolean callable_has_results (GICallableInfo *cb_info);
+static void queue_coalesced_args (SV *coalesced);
+static gboolean native_callable_from_sv (SV *sv, GPerlI11nNativeCallable *native);
+static gboolean native_signature_matches (const GPerlI11nNativeCallable *native,
+                                          GICallableInfo *expected,
+                                          gboolean expected_is_signal,
+                                          GType first_type,
+                                          GType last_type);
+static GPerlI11nPerlCallbackInfo * create_native_callback_info (const GPerlI11nNativeCallable *native,
+                                                                GIScopeType scope);
+static const GPerlI11nFunctionEntry * find_finish_function (GICallableInfo *async_info,
+                                                           GIBaseInfo *callback_interface_info);
+
+static void register_async_perl_callback (GPerlI11nPerlCallbackInfo *info);
+static void finish_async_perl_callback (GPerlI11nPerlCallbackInfo *info);
+static void release_finished_async_perl_callbacks (void);
+
+/* dispatch of callbacks from foreign threads */
+static void enable_foreign_thread_dispatch (gpointer perl_context, gboolean enable);
+static void hold_foreign_thread_dispatch (gpointer perl_context, gboolean hold);
+static gboolean dispatch_foreign_perl_callback (GPerlI11nPerlCallbackInfo *info,
+                                                const GPerlI11nPerlPlan *plan,
+                                                ffi_cif *cif,
+                                                gpointer resp,
+                                                gpointer *args);
+
+static gboolean is_comparator_sv (SV *sv);
+static GPerlI11nPerlCallbackInfo * create_native_comparator_closure (GICallableInfo *cb_info, SV *sv, gboolean keep_keys);
+static void comparator_free (struct _GPerlI11nComparator *comparator);
 
 static GPerlI11nCCallbackInfo * create_c_callback_closure (GIBaseInfo *interface, gpointer func);
 static void attach_c_callback_data (GPerlI11nCCallbackInfo *info, gpointer data);
 static void release_c_callback (gpointer data);
 
 /* invocation */
-static void prepare_invocation_info (GPerlI11nInvocationInfo *iinfo,
-                                     GICallableInfo *info);
+static void prepare_invocation_info_from_plan (GPerlI11nInvocationInfo *iinfo,
+                                               const GPerlI11nPlan *plan);
 static void clear_invocation_info (GPerlI11nInvocationInfo *iinfo);
 
 static void free_after_call (GPerlI11nInvocationInfo *iinfo,
@@ -198,13 +421,50 @@ static void invoke_perl_code (ffi_cif* cif,
                               gpointer* args,
                               gpointer userdata);
 
-static void invoke_c_code (GICallableInfo *info,
+static GPerlI11nCPlan * c_plan_new (GICallableInfo *info);
+static void c_plan_free (GPerlI11nCPlan *plan);
+
+static GPerlI11nPerlPlan * perl_plan_new (GICallableInfo *info);
+static void perl_plan_free (GPerlI11nPerlPlan *plan);
+
+static void invoke_c_code (const GPerlI11nCPlan *plan,
                            gpointer func_pointer,
                            SV **sp, I32 ax, SV **mark, I32 items, /* these correspond to dXSARGS */
                            UV internal_stack_offset,
                            const gchar *package,
                            const gchar *namespace,
                            const gchar *function);
+static SV * invoke_c_code_async (const GPerlI11nCPlan *plan,
+                                 gpointer func_pointer,
+                                 SV **sp, I32 ax, SV **mark, I32 items, /* these correspond to dXSARGS */
+                                 UV internal_stack_offset,
+                                 const gchar *package,
+                                 const gchar *namespace,
+                                 const gchar *function);
+static SV * new_future (void);
+static void invoke_finish_into_future (const GPerlI11nFunctionEntry *finish,
+                                       GObject *source_object,
+                                       GObject *res,
+                                       SV *future);
+static SV * invoke_c_code_async_bulk (const GPerlI11nFunctionEntry *entry,
+                                      AV *arg_tuples,
+                                      gint max_in_flight,
+                                      gint batch_size,
+                                      SV *on_batch,
+                                      const gchar *package,
+                                      const gchar *namespace,
+                                      const gchar *function);
+static void complete_async_bulk_op (GPerlI11nAsyncBulk *bulk,
+                                    gint index,
+                                    const GPerlI11nFunctionEntry *finish,
+                                    GObject *source_object,
+                                    GObject *res);
+static AV * invoke_c_code_parallel (const GPerlI11nCPlan *plan,
+                                    gpointer func_pointer,
+                                    AV *arg_tuples,
+                                    const gchar *package,
+                                    const gchar *namespace,
+                                    const gchar *function);
 
 /* info finders */
 static GIFunctionInfo * get_function_info (GIRepository *repository,
@@ -216,12 +476,34 @@ static GIFieldInfo * get_field_info (GIBaseInfo *info,
 static GISignalInfo * get_signal_info (GIBaseInfo *container_info,
                                        const gchar *signal_name);
 
+/* caches */
+static GIBaseInfo * get_cached_namespace_info (const gchar *basename,
+                                               const gchar *namespace);
+static const GPerlI11nFunctionEntry * get_cached_function_entry (const gchar *basename,
+                                                                 const gchar *namespace,
+                                                                 const gchar *function);
+static GIFieldInfo * get_cached_field_info (const gchar *basename,
+                                            const gchar *namespace,
+                                            const gchar *field);
+static const GPerlI11nCPlan * get_cached_vfunc_plan (GIObjectInfo *info,
+                                                     GIVFuncInfo *vfunc_info);
+static gint find_member_index (GIBaseInfo *info,
+                               GPerlI11nMemberKind kind,
+                               const gchar *name);
+static GIBaseInfo * find_member (GIBaseInfo *info,
+                                 GPerlI11nMemberKind kind,
+                                 const gchar *name);
+static GIBaseInfo * get_member (GIBaseInfo *info,
+                                GPerlI11nMemberKind kind,
+                                gint index);
+
 static gchar * synthesize_gtype_name (GIBaseInfo *info);
 static gchar * synthesize_prefixed_gtype_name (GIBaseInfo *info);
 static GType get_gtype (GIRegisteredTypeInfo *info);
 
 static const gchar * get_package_for_basename (const gchar *basename);
 static gboolean is_forbidden_sub_name (const gchar *name);
+static gboolean is_type_selected (SV *filter, const gchar *name);
 
 /* marshallers */
 static SV * interface_to_sv (GITypeInfo* info,
@@ -274,6 +556,11 @@ static gpointer sv_to_ghash (GITransfer transfer, GITypeInfo *type_info, SV *sv)
 #define CAST_RAW(raw, type) (*((type *) raw))
 static void raw_to_arg (gpointer raw, GIArgument *arg, GITypeInfo *info);
 static void arg_to_raw (GIArgument *arg, gpointer raw, GITypeInfo *info);
+static void gvalue_to_arg (const GValue *value, GIArgument *arg, GITypeInfo *info);
+
+/* constants */
+static SV * constant_to_sv (GIConstantInfo *info);
+static void install_constants (const gchar *basename, HV *sub_names);
 
 /* sizes */
 static gsize size_of_type_tag (GITypeTag type_tag);
@@ -283,6 +570,14 @@ static gsize size_of_type_info (GITypeInfo *type_info);
 /* enums/flags */
 static GType register_unregistered_enum (GIEnumInfo *info);
 
+/* args conversions */
+static struct _GPerlI11nArgsConversion * args_conversion_new (GISignalInfo *signal_info, AV *spec);
+static void args_conversion_free (struct _GPerlI11nArgsConversion *conversion);
+static void apply_args_conversion (const struct _GPerlI11nArgsConversion *conversion,
+                                   SV **values,
+                                   gpointer *pointers,
+                                   SV **converted);
+
 /* fields */
 static void store_fields (HV *fields, GIBaseInfo *info, GIInfoType info_type);
 static SV * get_field (GIFieldInfo *field_info, gpointer mem, GITransfer transfer);
@@ -299,10 +594,22 @@ static void store_methods (HV *namespaced_functions, GIBaseInfo *info, GIInfoTyp
 /* object vfuncs */
 static void store_objects_with_vfuncs (AV *objects_with_vfuncs, GIObjectInfo *info);
 static void generic_class_init (GIObjectInfo *info, const gchar *target_package, gpointer class);
+static const GPerlI11nVFuncTable * get_vfunc_table (GIObjectInfo *info);
+static const GPerlI11nVFuncTable * get_vfunc_table_for_gtype (GType gtype);
+static const GPerlI11nVFuncEntry * find_vfunc_entry (const GPerlI11nVFuncTable *table, const gchar *vfunc_name);
+static gint install_fallback_vfuncs (GIObjectInfo *object_info, const gchar *target_package, HV *seen);
 
 /* interface vfuncs */
 static void generic_interface_init (gpointer iface, gpointer data);
 static void generic_interface_finalize (gpointer iface, gpointer data);
+static void install_deferred_interface_vfuncs (void);
+
+/* module state */
+static void init_module_state (void);
+static void remember_signal_args_converter (const GPerlI11nPerlSignalInfo *signal_info,
+                                            SV *args_converter);
+static SV * find_signal_args_converter (gpointer perl_context,
+                                        const GPerlI11nPerlSignalInfo *signal_info);
 
 /* misc. */
 static void call_carp_croak (const char *msg);
@@ -321,10 +628,31 @@ static void call_carp_carp (const char *msg);
 		_saved_stack_sv;		\
 	})
 
+/* Module state that refers to Perl data; see gperl-i11n-state.c. */
+#define MY_CXT_KEY "Glib::Object::Introspection::_guts" XS_VERSION
+typedef struct {
+	HV *basename_to_package;
+	HV *forbidden_sub_names;
+	HV *signal_args_converters;
+	/* the subs that vfunc closures resolved to; see _resolve_method */
+	GHashTable *resolved_methods;
+	GQueue resolved_methods_lru;
+	/* the vfunc closures created by this interpreter; see
+	 * get_shared_perl_callback_closure_for_vfunc */
+	GHashTable *vfunc_closures;
+} my_cxt_t;
+START_MY_CXT
+
 /* ------------------------------------------------------------------------- */
 
+#include "gperl-i11n-cache.c"
 #include "gperl-i11n-callback.c"
+#include "gperl-i11n-coalesce.c"
+#include "gperl-i11n-comparator.c"
+#include "gperl-i11n-constant.c"
+#include "gperl-i11n-convert.c"
 #include "gperl-i11n-croak.c"
+#include "gperl-i11n-dispatch.c"
 #include "gperl-i11n-enums.c"
 #include "gperl-i11n-field.c"
 #include "gperl-i11n-gvalue.c"
@@ -341,7 +669,10 @@ static void call_carp_carp (const char *msg);
 #include "gperl-i11n-marshal-raw.c"
 #include "gperl-i11n-marshal-struct.c"
 #include "gperl-i11n-method.c"
+#include "gperl-i11n-native.c"
+#include "gperl-i11n-signal.c"
 #include "gperl-i11n-size.c"
+#include "gperl-i11n-state.c"
 #include "gperl-i11n-union.c"
 #include "gperl-i11n-vfunc-interface.c"
 #include "gperl-i11n-vfunc-object.c"
@@ -350,6 +681,20 @@ static void call_carp_carp (const char *msg);
 
 MODULE = Glib::Object::Introspection	PACKAGE = Glib::Object::Introspection
 
+BOOT:
+{
+	MY_CXT_INIT;
+	init_module_state ();
+}
+
+void
+CLONE (...)
+    CODE:
+	{
+		MY_CXT_CLONE;
+		init_module_state ();
+	}
+
 gboolean
 CHECK_VERSION (class, gint major, gint minor, gint micro)
     CODE:
@@ -375,9 +720,10 @@ _load_library (class, namespace, version, search_path=NULL)
 	}
 
 void
-_register_types (class, namespace, package)
+_register_types (class, namespace, package, type_filter=NULL)
 	const gchar *namespace
 	const gchar *package
+	SV *type_filter
     PREINIT:
 	GIRepository *repository;
 	gint number, i;
@@ -387,6 +733,8 @@ _register_types (class, namespace, package)
 	HV *fields;
 	AV *interfaces;
 	AV *objects_with_vfuncs;
+	HV *counts;
+	guint n_types_registered = 0;
     PPCODE:
 	repository = g_irepository_get_default ();
 
@@ -397,6 +745,12 @@ _register_types (class, namespace, package)
 	interfaces = newAV ();
 	objects_with_vfuncs = newAV ();
 
+	if (type_filter && !gperl_sv_is_defined (type_filter))
+		type_filter = NULL;
+	/* The type filter calls Perl code, which might reallocate the stack.
+	 * So sync it here and get our 'sp' back after the loop. */
+	PUTBACK;
+
 	number = g_irepository_get_n_infos (repository, namespace);
 	for (i = 0; i < number; i++) {
 		GIBaseInfo *info;
@@ -411,6 +765,21 @@ _register_types (class, namespace, package)
 
 		dwarn ("setting up %s.%s\n", namespace, name);
 
+		if (type_filter &&
+		    (info_type == GI_INFO_TYPE_OBJECT ||
+		     info_type == GI_INFO_TYPE_INTERFACE ||
+		     info_type == GI_INFO_TYPE_BOXED ||
+		     info_type == GI_INFO_TYPE_STRUCT ||
+		     info_type == GI_INFO_TYPE_UNION ||
+		     info_type == GI_INFO_TYPE_ENUM ||
+		     info_type == GI_INFO_TYPE_FLAGS) &&
+		    !is_type_selected (type_filter, name))
+		{
+			dwarn ("  -> skipped\n");
+			g_base_info_unref ((GIBaseInfo *) info);
+			continue;
+		}
+
 		if (info_type == GI_INFO_TYPE_CONSTANT) {
 			dwarn ("  -> constant\n");
 			av_push (constants, newSVpv (name, 0));
@@ -484,6 +853,7 @@ _register_types (class, namespace, package)
 
 		full_package = g_strconcat (package, "::", name, NULL);
 		dwarn ("  registering as %s\n", full_package);
+		n_types_registered++;
 
 		switch (info_type) {
 		    case GI_INFO_TYPE_OBJECT:
@@ -535,16 +905,25 @@ _register_types (class, namespace, package)
 		g_base_info_unref ((GIBaseInfo *) info);
 	}
 
+	SPAGAIN;
+
 	/* Use the empty string as the key to indicate "no namespace". */
 	gperl_hv_take_sv (namespaced_functions, "", 0,
 	                  newRV_noinc ((SV *) global_functions));
 
-	EXTEND (SP, 5);
+	/* Some numbers for the startup profile. */
+	counts = newHV ();
+	gperl_hv_take_sv (counts, "infos_visited", 13, newSViv (number));
+	gperl_hv_take_sv (counts, "types_registered", 16,
+	                  newSVuv (n_types_registered));
+
+	EXTEND (SP, 6);
 	PUSHs (sv_2mortal (newRV_noinc ((SV *) namespaced_functions)));
 	PUSHs (sv_2mortal (newRV_noinc ((SV *) constants)));
 	PUSHs (sv_2mortal (newRV_noinc ((SV *) fields)));
 	PUSHs (sv_2mortal (newRV_noinc ((SV *) interfaces)));
 	PUSHs (sv_2mortal (newRV_noinc ((SV *) objects_with_vfuncs)));
+	PUSHs (sv_2mortal (newRV_noinc ((SV *) counts)));
 
 # This is only semi-private, as Gtk3 needs it.  But it doesn't seem generally
 # applicable, so it doesn't get an import() API.
@@ -590,30 +969,24 @@ _fetch_constant (class, basename, constant)
     PREINIT:
 	GIRepository *repository;
 	GIConstantInfo *info;
-	GITypeInfo *type_info;
-	GIArgument value = {0,};
     CODE:
 	repository = g_irepository_get_default ();
 	info = g_irepository_find_by_name (repository, basename, constant);
 	if (!GI_IS_CONSTANT_INFO (info))
 		ccroak ("not a constant");
-	type_info = g_constant_info_get_type (info);
-	/* FIXME: What am I suppossed to do with the return value? */
-	g_constant_info_get_value (info, &value);
 	/* No PUTBACK/SPAGAIN needed here. */
-	RETVAL = arg_to_sv (&value,
-	                    type_info,
-	                    GI_TRANSFER_NOTHING,
-	                    GPERL_I11N_MEMORY_SCOPE_IRRELEVANT,
-	                    NULL);
-#if GI_CHECK_VERSION (1, 30, 1)
-	g_constant_info_free_value (info, &value);
-#endif
-	g_base_info_unref ((GIBaseInfo *) type_info);
+	RETVAL = constant_to_sv (info);
 	g_base_info_unref ((GIBaseInfo *) info);
     OUTPUT:
 	RETVAL
 
+void
+_install_constants (class, const gchar *basename, SV *sub_names)
+    CODE:
+	if (!gperl_sv_is_hash_ref (sub_names))
+		ccroak ("the constants must be given as a hash reference");
+	install_constants (basename, (HV *) SvRV (sub_names));
+
 SV *
 _construct_boxed (class, package)
 	const gchar *package
@@ -662,18 +1035,16 @@ _get_field (class, basename, namespace, field, invocant)
 	const gchar *field
 	SV *invocant
     PREINIT:
-	GIRepository *repository;
 	GIBaseInfo *namespace_info;
 	GIFieldInfo *field_info;
 	GType invocant_type;
 	gpointer boxed_mem;
     CODE:
-	repository = g_irepository_get_default ();
-	namespace_info = g_irepository_find_by_name (repository, basename, namespace);
+	namespace_info = get_cached_namespace_info (basename, namespace);
 	if (!namespace_info)
 		ccroak ("Could not find information for namespace '%s'",
 		        namespace);
-	field_info = get_field_info (namespace_info, field);
+	field_info = get_cached_field_info (basename, namespace, field);
 	if (!field_info)
 		ccroak ("Could not find field '%s' in namespace '%s'",
 		        field, namespace)
@@ -692,8 +1063,6 @@ _get_field (class, basename, namespace, field, invocant)
 	boxed_mem = gperl_get_boxed_check (invocant, invocant_type);
 	/* No PUTBACK/SPAGAIN needed here. */
 	RETVAL = get_field (field_info, boxed_mem, GI_TRANSFER_NOTHING);
-	g_base_info_unref (field_info);
-	g_base_info_unref (namespace_info);
     OUTPUT:
 	RETVAL
 
@@ -705,18 +1074,16 @@ _set_field (class, basename, namespace, field, invocant, new_value)
 	SV *invocant
 	SV *new_value
     PREINIT:
-	GIRepository *repository;
 	GIBaseInfo *namespace_info;
 	GIFieldInfo *field_info;
 	GType invocant_type;
 	gpointer boxed_mem;
     CODE:
-	repository = g_irepository_get_default ();
-	namespace_info = g_irepository_find_by_name (repository, basename, namespace);
+	namespace_info = get_cached_namespace_info (basename, namespace);
 	if (!namespace_info)
 		ccroak ("Could not find information for namespace '%s'",
 		        namespace);
-	field_info = get_field_info (namespace_info, field);
+	field_info = get_cached_field_info (basename, namespace, field);
 	if (!field_info)
 		ccroak ("Could not find field '%s' in namespace '%s'",
 		        field, namespace)
@@ -741,33 +1108,42 @@ _set_field (class, basename, namespace, field, invocant, new_value)
 	 * g_field_info_set_field, and by extension set_field, simply refuse to
 	 * set any member that would require such memory management. */
 	set_field (field_info, boxed_mem, GI_TRANSFER_EVERYTHING, new_value);
-	g_base_info_unref (field_info);
-	g_base_info_unref (namespace_info);
 
 void
-_add_interface (class, basename, interface_name, target_package)
+_add_interface (class, basename, interface_name, target_package, defer=FALSE)
 	const gchar *basename
 	const gchar *interface_name
 	const gchar *target_package
+	gboolean defer
     PREINIT:
 	GIRepository *repository;
 	GIInterfaceInfo *info;
 	GInterfaceInfo iface_info;
+	GPerlI11nInterfaceData *iface_data;
 	GType gtype;
     CODE:
 	repository = g_irepository_get_default ();
 	info = g_irepository_find_by_name (repository, basename, interface_name);
 	if (!GI_IS_INTERFACE_INFO (info))
 		ccroak ("not an interface");
-	iface_info.interface_init = generic_interface_init;
-	iface_info.interface_finalize = generic_interface_finalize,
-	iface_info.interface_data = info;
 	gtype = gperl_object_type_from_package (target_package);
 	if (!gtype)
 		ccroak ("package '%s' is not registered with Glib-Perl",
 		        target_package);
+	iface_data = g_new0 (GPerlI11nInterfaceData, 1);
+	iface_data->info = info;
+	iface_data->target_package = g_strdup (target_package);
+	iface_data->defer = defer;
+	iface_info.interface_init = generic_interface_init;
+	iface_info.interface_finalize = generic_interface_finalize,
+	iface_info.interface_data = iface_data;
 	g_type_add_interface_static (gtype, get_gtype (info), &iface_info);
-	/* info is unref'd in generic_interface_finalize */
+	/* iface_data is freed in generic_interface_finalize */
+
+void
+_install_deferred_interface_vfuncs (class)
+    CODE:
+	install_deferred_interface_vfuncs ();
 
 void
 _install_overrides (class, basename, object_name, target_package)
@@ -775,16 +1151,14 @@ _install_overrides (class, basename, object_name, target_package)
 	const gchar *object_name
 	const gchar *target_package
     PREINIT:
-	GIRepository *repository;
 	GIObjectInfo *info;
 	GType gtype;
 	gpointer klass;
     CODE:
 	dwarn ("%s.%s for %s\n",
 	       basename, object_name, target_package);
-	repository = g_irepository_get_default ();
-	info = g_irepository_find_by_name (repository, basename, object_name);
-	if (!GI_IS_OBJECT_INFO (info))
+	info = get_cached_namespace_info (basename, object_name);
+	if (!info || !GI_IS_OBJECT_INFO (info))
 		ccroak ("not an object");
 	gtype = gperl_object_type_from_package (target_package);
 	if (!gtype)
@@ -795,7 +1169,6 @@ _install_overrides (class, basename, object_name, target_package)
 		ccroak ("internal problem: can't peek at type class for %s (%" G_GSIZE_FORMAT ")",
 		        g_type_name (gtype), gtype);
 	generic_class_init (info, target_package, klass);
-	g_base_info_unref (info);
 
 void
 _find_non_perl_parents (class, basename, object_name, target_package)
@@ -803,14 +1176,12 @@ _find_non_perl_parents (class, basename, object_name, target_package)
 	const gchar *object_name
 	const gchar *target_package
     PREINIT:
-	GIRepository *repository;
 	GIObjectInfo *info;
 	GType gtype, object_gtype;
 	/* FIXME: we should export gperl_type_reg_quark from Glib */
 	GQuark reg_quark = g_quark_from_static_string ("__gperl_type_reg");
     PPCODE:
-	repository = g_irepository_get_default ();
-	info = g_irepository_find_by_name (repository, basename, object_name);
+	info = get_cached_namespace_info (basename, object_name);
 	g_assert (info && GI_IS_OBJECT_INFO (info));
 	gtype = gperl_object_type_from_package (target_package);
 	object_gtype = get_gtype (info);
@@ -824,43 +1195,30 @@ _find_non_perl_parents (class, basename, object_name, target_package)
 			break;
 		}
 	}
-	g_base_info_unref (info);
 
 void
 _find_vfuncs_with_implementation (class, object_package, target_package)
 	const gchar *object_package
 	const gchar *target_package
     PREINIT:
-	GIRepository *repository;
 	GType object_gtype, target_gtype;
 	gpointer object_klass, target_klass;
-	GIObjectInfo *object_info;
-	gint n_vfuncs, i;
+	const GPerlI11nVFuncTable *table;
+	guint i;
     PPCODE:
-	repository = g_irepository_get_default ();
 	target_gtype = gperl_object_type_from_package (target_package);
 	object_gtype = gperl_object_type_from_package (object_package);
 	g_assert (target_gtype && object_gtype);
 	target_klass = g_type_class_peek (target_gtype);
 	object_klass = g_type_class_peek (object_gtype);
 	g_assert (target_klass && object_klass);
-	object_info = g_irepository_find_by_gtype (repository, object_gtype);
-	g_assert (object_info && GI_IS_OBJECT_INFO (object_info));
-	n_vfuncs = g_object_info_get_n_vfuncs (object_info);
-	for (i = 0; i < n_vfuncs; i++) {
-		GIVFuncInfo *vfunc_info;
-		const gchar *vfunc_name;
-		gint field_offset;
-		vfunc_info = g_object_info_get_vfunc (object_info, i);
-		vfunc_name = g_base_info_get_name (vfunc_info);
-		/* FIXME: g_vfunc_info_get_offset does not seem to work here. */
-		field_offset = get_vfunc_offset (object_info, vfunc_name);
-		if (G_STRUCT_MEMBER (gpointer, target_klass, field_offset)) {
-			XPUSHs (sv_2mortal (newSVpv (vfunc_name, 0)));
+	table = get_vfunc_table_for_gtype (object_gtype);
+	for (i = 0; i < table->n_vfuncs; i++) {
+		const GPerlI11nVFuncEntry *entry = &table->vfuncs[i];
+		if (G_STRUCT_MEMBER (gpointer, target_klass, entry->field_offset)) {
+			XPUSHs (sv_2mortal (newSVpv (entry->name, 0)));
 		}
-		g_base_info_unref (vfunc_info);
 	}
-	g_base_info_unref (object_info);
 
 void
 _invoke_fallback_vfunc (class, vfunc_package, vfunc_name, target_package, ...)
@@ -869,12 +1227,10 @@ _invoke_fallback_vfunc (class, vfunc_package, vfunc_name, target_package, ...)
 	const gchar *target_package
     PREINIT:
 	UV internal_stack_offset = 4;
-	GIRepository *repository;
-	GIObjectInfo *info;
+	const GPerlI11nVFuncTable *table;
 	GType gtype;
 	gpointer klass;
-	GIVFuncInfo *vfunc_info;
-	gint field_offset;
+	const GPerlI11nVFuncEntry *entry;
 	gpointer func_pointer;
     PPCODE:
 	dwarn ("%s::%s, target = %s\n",
@@ -882,17 +1238,13 @@ _invoke_fallback_vfunc (class, vfunc_package, vfunc_name, target_package, ...)
 	gtype = gperl_object_type_from_package (target_package);
 	klass = g_type_class_peek (gtype);
 	g_assert (klass);
-	repository = g_irepository_get_default ();
-	info = g_irepository_find_by_gtype (
-		repository, gperl_object_type_from_package (vfunc_package));
-	g_assert (info && GI_IS_OBJECT_INFO (info));
-	vfunc_info = g_object_info_find_vfunc (info, vfunc_name);
-	g_assert (vfunc_info);
-	/* FIXME: g_vfunc_info_get_offset does not seem to work here. */
-	field_offset = get_vfunc_offset (info, vfunc_name);
-	func_pointer = G_STRUCT_MEMBER (gpointer, klass, field_offset);
+	table = get_vfunc_table_for_gtype (
+		gperl_object_type_from_package (vfunc_package));
+	entry = find_vfunc_entry (table, vfunc_name);
+	g_assert (entry);
+	func_pointer = G_STRUCT_MEMBER (gpointer, klass, entry->field_offset);
 	g_assert (func_pointer);
-	invoke_c_code (vfunc_info, func_pointer,
+	invoke_c_code (get_cached_vfunc_plan (table->info, entry->vfunc_info), func_pointer,
 	               sp, ax, mark, items,
 	               internal_stack_offset,
 	               NULL, NULL, NULL);
@@ -900,8 +1252,23 @@ _invoke_fallback_vfunc (class, vfunc_package, vfunc_name, target_package, ...)
 	 * pointer.  so we need to make sure that our local variable
 	 * 'sp' is correct before the implicit PUTBACK happens. */
 	SPAGAIN;
-	g_base_info_unref (vfunc_info);
-	g_base_info_unref (info);
+
+gint
+_install_fallback_vfuncs (class, basename, object_name, target_package, SV *seen)
+	const gchar *basename
+	const gchar *object_name
+	const gchar *target_package
+    PREINIT:
+	GIObjectInfo *info;
+    CODE:
+	if (!gperl_sv_is_hash_ref (seen))
+		ccroak ("the seen packages must be given as a hash reference");
+	info = get_cached_namespace_info (basename, object_name);
+	g_assert (info && GI_IS_OBJECT_INFO (info));
+	RETVAL = install_fallback_vfuncs (info, target_package,
+	                                  (HV *) SvRV (seen));
+    OUTPUT:
+	RETVAL
 
 void
 _use_generic_signal_marshaller_for (class, const gchar *package, const gchar *signal, SV *args_converter=NULL)
@@ -909,74 +1276,36 @@ _use_generic_signal_marshaller_for (class, const gchar *package, const gchar *si
 #if GI_CHECK_VERSION (1, 33, 10)
 {
 	GType gtype;
-	GIRepository *repository;
 	GIBaseInfo *container_info;
-	GPerlI11nPerlSignalInfo *signal_info;
-	ffi_cif *cif;
-	ffi_closure *closure;
-	GIBaseInfo *closure_marshal_info;
+	GISignalInfo *signal_info;
+	GClosureMarshal marshaller;
 
 	gtype = gperl_type_from_package (package);
 	if (!gtype)
 		ccroak ("Could not find GType for package %s", package);
 
-	repository = g_irepository_get_default ();
-	container_info = g_irepository_find_by_gtype (repository, gtype);
+	container_info = g_irepository_find_by_gtype (g_irepository_get_default (),
+	                                              gtype);
 	if (!container_info ||
 	    !(GI_IS_OBJECT_INFO (container_info) ||
 	      GI_IS_INTERFACE_INFO (container_info)))
 		ccroak ("Could not find object/interface info for package %s",
 		        package);
 
-	signal_info = g_new0 (GPerlI11nPerlSignalInfo, 1); // FIXME: ctor?
-	signal_info->interface = get_signal_info (container_info, signal);
-	if (args_converter)
-		signal_info->args_converter = SvREFCNT_inc (args_converter);
+	signal_info = get_signal_info (container_info, signal);
+	g_base_info_unref (container_info);
 	if (!signal_info)
 		ccroak ("Could not find signal %s for package %s",
 		        signal, package);
-
-	closure_marshal_info = g_irepository_find_by_name (repository,
-		                                           "GObject",
-	                                                   "ClosureMarshal");
-	g_assert (closure_marshal_info);
-	cif = g_new0 (ffi_cif, 1);
-#if GI_CHECK_VERSION (1, 72, 0)
-	closure = g_callable_info_create_closure (closure_marshal_info,
-	                                          cif,
-	                                          invoke_perl_signal_handler,
-	                                          signal_info);
-        if (closure != NULL)
-                closure =
-                        (ffi_closure *) g_callable_info_get_closure_native_address (closure_marshal_info,
-                                                                                    closure);
-#else
-        G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-	closure = g_callable_info_prepare_closure (closure_marshal_info,
-	                                           cif,
-	                                           invoke_perl_signal_handler,
-	                                           signal_info);
-        G_GNUC_END_IGNORE_DEPRECATIONS
-#endif
-	g_base_info_unref (closure_marshal_info);
-
-	dwarn ("package = %s, signal = %s => closure = %p\n",
-	       package, signal, closure);
-	gperl_signal_set_marshaller_for (gtype, (gchar*) signal, (GClosureMarshal) closure);
-
-	/* These should be freed when the signal marshaller is not needed
-	 * anymore.  But gperl_signal_set_marshaller_for does not provide a
-	 * hook for resource freeing.
-	 *
-	 * g_callable_info_free_closure (signal_info, closure);
-	 * g_free (cif);
-	 * g_base_info_unref (signal_info->interface);
-	 * if (signal_info->args_converter)
-	 * 	SvREFCNT_dec (signal_info->args_converter);
-	 * g_free (signal_info);
-	 */
-
-	g_base_info_unref (container_info);
+	marshaller = create_generic_signal_marshaller (signal_info,
+	                                               args_converter);
+	g_base_info_unref (signal_info);
+
+	dwarn ("package = %s, signal = %s => marshaller = %p\n",
+	       package, signal, marshaller);
+	gperl_signal_set_marshaller_for (gtype, (gchar*) signal, marshaller);
+	/* keep lazily installed marshallers from replacing this one */
+	mark_signal_prepared (gtype, signal);
 }
 #else
 {
@@ -994,6 +1323,45 @@ _use_generic_signal_marshaller_for (class, const gchar *package, const gchar *si
 }
 #endif
 
+void
+_use_generic_signal_marshallers_for_namespace (class, const gchar *namespace)
+    CODE:
+	enable_generic_signal_marshallers (namespace);
+
+void
+_prepare_generic_signal_marshaller (class, SV *instance, const gchar *detailed_signal)
+    PREINIT:
+	GObject *object;
+    CODE:
+	/* anything else is left for the connect call to complain about */
+	if (!SvROK (instance) || !sv_derived_from (instance, "Glib::Object"))
+		XSRETURN_EMPTY;
+	object = gperl_get_object (instance);
+	if (object)
+		prepare_generic_signal_marshaller (G_OBJECT_TYPE (object),
+		                                   detailed_signal);
+
+void
+_check_coalesced_signal_handler (class, SV *instance, const gchar *detailed_signal)
+    PREINIT:
+	GObject *object;
+	guint signal_id;
+	GQuark detail;
+	GSignalQuery query;
+    CODE:
+	/* anything else is left for the connect call to complain about */
+	if (!SvROK (instance) || !sv_derived_from (instance, "Glib::Object"))
+		XSRETURN_EMPTY;
+	object = gperl_get_object (instance);
+	if (!object ||
+	    !g_signal_parse_name (detailed_signal, G_OBJECT_TYPE (object),
+	                          &signal_id, &detail, TRUE))
+		XSRETURN_EMPTY;
+	g_signal_query (signal_id, &query);
+	if (query.return_type != G_TYPE_NONE)
+		ccroak ("%s returns values and thus cannot be coalesced",
+		        query.signal_name);
+
 void
 invoke (class, basename, namespace, function, ...)
 	const gchar *basename
@@ -1001,21 +1369,11 @@ invoke (class, basename, namespace, function, ...)
 	const gchar *function
     PREINIT:
 	UV internal_stack_offset = 4;
-	GIRepository *repository;
-	GIFunctionInfo *info;
-	gpointer func_pointer = NULL;
-	const gchar *symbol = NULL;
+	const GPerlI11nFunctionEntry *entry;
     PPCODE:
-	repository = g_irepository_get_default ();
-	info = get_function_info (repository, basename, namespace, function);
-	symbol = g_function_info_get_symbol (info);
-	if (!g_typelib_symbol (g_base_info_get_typelib((GIBaseInfo *) info),
-			       symbol, &func_pointer))
-	{
-		g_base_info_unref ((GIBaseInfo *) info);
-		ccroak ("Could not locate symbol %s", symbol);
-	}
-	invoke_c_code (info, func_pointer,
+	/* The entry is owned by the function cache. */
+	entry = get_cached_function_entry (basename, namespace, function);
+	invoke_c_code (entry->plan, entry->func_pointer,
 	               sp, ax, mark, items,
 	               internal_stack_offset,
 	               get_package_for_basename (basename), namespace, function);
@@ -1023,7 +1381,163 @@ invoke (class, basename, namespace, function, ...)
 	 * so we need to make sure that our implicit local variable 'sp' is
 	 * correct before the implicit PUTBACK happens. */
 	SPAGAIN;
-	g_base_info_unref ((GIBaseInfo *) info);
+
+SV *
+invoke_async (class, basename, namespace, function, ...)
+	const gchar *basename
+	const gchar_ornull *namespace
+	const gchar *function
+    PREINIT:
+	UV internal_stack_offset = 4;
+	const GPerlI11nFunctionEntry *entry;
+    CODE:
+	entry = get_cached_function_entry (basename, namespace, function);
+	RETVAL = invoke_c_code_async (entry->plan, entry->func_pointer,
+	                              sp, ax, mark, items,
+	                              internal_stack_offset,
+	                              get_package_for_basename (basename),
+	                              namespace, function);
+    OUTPUT:
+	RETVAL
+
+SV *
+_invoke_async_bulk (class, basename, namespace, function, SV *arg_tuples, gint max_in_flight, gint batch_size, SV *on_batch)
+	const gchar *basename
+	const gchar_ornull *namespace
+	const gchar *function
+    CODE:
+	if (!gperl_sv_is_array_ref (arg_tuples))
+		ccroak ("the argument tuples must be given as an array reference");
+	RETVAL = invoke_c_code_async_bulk (
+	           get_cached_function_entry (basename, namespace, function),
+	           (AV *) SvRV (arg_tuples),
+	           max_in_flight, batch_size, on_batch,
+	           get_package_for_basename (basename), namespace, function);
+    OUTPUT:
+	RETVAL
+
+SV *
+invoke_parallel (class, basename, namespace, function, SV *arg_tuples)
+	const gchar *basename
+	const gchar_ornull *namespace
+	const gchar *function
+    PREINIT:
+	const GPerlI11nFunctionEntry *entry;
+    CODE:
+	if (!gperl_sv_is_array_ref (arg_tuples))
+		ccroak ("the argument tuples must be given as an array reference");
+	entry = get_cached_function_entry (basename, namespace, function);
+	RETVAL = newRV_noinc ((SV *) invoke_c_code_parallel (
+	                      entry->plan, entry->func_pointer,
+	                      (AV *) SvRV (arg_tuples),
+	                      get_package_for_basename (basename),
+	                      namespace, function));
+    OUTPUT:
+	RETVAL
+
+gulong
+_signal_connect_native (class, SV *instance, const gchar *detailed_signal, SV *native_sv, SV *data, gboolean swapped, gboolean after)
+    PREINIT:
+	GPerlI11nNativeCallable native;
+    CODE:
+	if (!native_callable_from_sv (native_sv, &native))
+		ccroak ("the handler must be a native function");
+	RETVAL = connect_native_signal_handler (
+	         gperl_get_object_check (instance, G_TYPE_OBJECT),
+	         detailed_signal, &native,
+	         gperl_sv_is_defined (data)
+	           ? gperl_get_object_check (data, G_TYPE_OBJECT)
+	           : NULL,
+	         swapped, after);
+    OUTPUT:
+	RETVAL
+
+void
+_warm (class, const gchar *basename, SV *entries=NULL)
+    PREINIT:
+	AV *av;
+	gint i, n;
+    CODE:
+	if (!entries || !gperl_sv_is_defined (entries)) {
+		warm_namespace (basename);
+	} else {
+		if (!gperl_sv_is_array_ref (entries))
+			ccroak ("the entries must be given as an array reference");
+		av = (AV *) SvRV (entries);
+		n = av_len (av) + 1;
+		for (i = 0; i < n; i++) {
+			SV **svp = av_fetch (av, i, 0);
+			SV **namespace_svp, **function_svp;
+			AV *entry;
+			if (!svp || !gperl_sv_is_array_ref (*svp))
+				ccroak ("each entry must be an array reference");
+			entry = (AV *) SvRV (*svp);
+			namespace_svp = av_fetch (entry, 0, 0);
+			function_svp = av_fetch (entry, 1, 0);
+			if (!function_svp || !gperl_sv_is_defined (*function_svp))
+				ccroak ("each entry must contain a function name");
+			warm_function (
+				basename,
+				namespace_svp && gperl_sv_is_defined (*namespace_svp)
+					? SvPV_nolen (*namespace_svp)
+					: NULL,
+				SvPV_nolen (*function_svp));
+		}
+	}
+
+gint
+_get_n_perl_callback_closures (class)
+    CODE:
+	RETVAL = g_atomic_int_get (&n_perl_callback_closures);
+    OUTPUT:
+	RETVAL
+
+void
+dispatch_foreign_thread_callbacks (class, gboolean enable)
+    CODE:
+#ifdef PERL_IMPLICIT_CONTEXT
+	enable_foreign_thread_dispatch (aTHX, enable);
+#else
+	enable_foreign_thread_dispatch (NULL, enable);
+#endif
+
+SV *
+async_callback_counts (class)
+    PREINIT:
+	HV *hv;
+    CODE:
+	/* Nothing is being invoked while we are in here, so finished async
+	 * callbacks can be released now. */
+	release_finished_async_perl_callbacks ();
+	hv = newHV ();
+	gperl_hv_take_sv (hv, "live", 4,
+	                  newSViv (g_atomic_int_get (&n_live_async_callbacks)));
+	gperl_hv_take_sv (hv, "released", 8,
+	                  newSViv (g_atomic_int_get (&n_released_async_callbacks)));
+	RETVAL = newRV_noinc ((SV *) hv);
+    OUTPUT:
+	RETVAL
+
+void
+record_usage (class, gboolean enable)
+    CODE:
+	usage_recording_enabled = enable;
+
+void
+usage_manifest (class)
+    PREINIT:
+	guint i;
+    PPCODE:
+	G_LOCK (cache);
+	for (i = 0; usage_manifest && i < usage_manifest->len; i++) {
+		gchar **entry = g_ptr_array_index (usage_manifest, i);
+		AV *av = newAV ();
+		av_push (av, newSVpv (entry[0], 0));
+		av_push (av, entry[1] ? newSVpv (entry[1], 0) : newSVsv (&PL_sv_undef));
+		av_push (av, newSVpv (entry[2], 0));
+		XPUSHs (sv_2mortal (newRV_noinc ((SV *) av)));
+	}
+	G_UNLOCK (cache);
 
 gint
 convert_sv_to_enum (class, const gchar *package, SV *sv)
@@ -1117,7 +1631,9 @@ _invoke (SV *code, ...)
 	wrapper = INT2PTR (GPerlI11nCCallbackInfo*, SvIV (SvRV (code)));
 	if (!wrapper || !wrapper->func)
 		ccroak ("invalid reference encountered");
-	invoke_c_code (wrapper->interface, wrapper->func,
+	if (!wrapper->plan)
+		wrapper->plan = c_plan_new (wrapper->interface);
+	invoke_c_code (wrapper->plan, wrapper->func,
 	               sp, ax, mark, items,
 	               internal_stack_offset,
 	               NULL, NULL, NULL);
@@ -0,0 +1,675 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+/* Caches for the things that are looked up over and over again: namespace
+ * infos, function infos together with their symbol and call plan, field infos
+ * and GTypes.  Everything in here only depends on the typelibs, so the caches
+ * are shared by all interpreters and guarded by a lock.  Entries are never
+ * removed, and callers get borrowed pointers, so that looking up a cached
+ * entry does not write to it.  This keeps the pages holding entries created
+ * before a fork shared between the processes. */
+
+G_LOCK_DEFINE_STATIC (cache);
+
+static GHashTable *namespace_infos = NULL;
+static GHashTable *function_entries = NULL;
+static GHashTable *field_infos = NULL;
+static GHashTable *vfunc_plans = NULL;
+static GHashTable *gtypes = NULL;
+
+static gboolean usage_recording_enabled = FALSE;
+static GPtrArray *usage_manifest = NULL;
+/* the keys of the functions in usage_manifest */
+static GHashTable *recorded_usage = NULL;
+
+#define CACHE_KEY_SIZE 256
+
+/* Cache keys have the form "basename:namespace:name".  They are formatted into
+ * buffer, or into a newly allocated string if they do not fit; either way,
+ * release them with _free_cache_key. */
+static const gchar *
+_format_cache_key (gchar *buffer,
+                   const gchar *basename,
+                   const gchar *namespace,
+                   const gchar *name)
+{
+	gint n = g_snprintf (buffer, CACHE_KEY_SIZE, "%s:%s:%s",
+	                     basename,
+	                     namespace ? namespace : "",
+	                     name ? name : "");
+	if (n >= 0 && n < CACHE_KEY_SIZE)
+		return buffer;
+	return g_strdup_printf ("%s:%s:%s",
+	                        basename,
+	                        namespace ? namespace : "",
+	                        name ? name : "");
+}
+
+static void
+_free_cache_key (gchar *buffer, const gchar *key)
+{
+	if (key != buffer)
+		g_free ((gchar *) key);
+}
+
+static gpointer
+_cache_lookup (GHashTable *table, const gchar *key)
+{
+	gpointer value = NULL;
+	G_LOCK (cache);
+	if (table)
+		value = g_hash_table_lookup (table, key);
+	G_UNLOCK (cache);
+	return value;
+}
+
+/* Stores value under key unless another value was stored in the meantime.
+ * Returns the value that ends up in the cache. */
+static gpointer
+_cache_insert (GHashTable **table, const gchar *key, gpointer value)
+{
+	gpointer existing;
+	G_LOCK (cache);
+	if (!*table)
+		*table = g_hash_table_new (g_str_hash, g_str_equal);
+	existing = g_hash_table_lookup (*table, key);
+	if (!existing)
+		g_hash_table_insert (*table, g_strdup (key), value);
+	G_UNLOCK (cache);
+	return existing ? existing : value;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns a borrowed reference, or NULL if there is no such info. */
+static GIBaseInfo *
+get_cached_namespace_info (const gchar *basename, const gchar *namespace)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key;
+	GIBaseInfo *info, *cached_info;
+
+	key = _format_cache_key (buffer, basename, namespace, NULL);
+	info = _cache_lookup (namespace_infos, key);
+	if (!info) {
+		info = g_irepository_find_by_name (g_irepository_get_default (),
+		                                   basename, namespace);
+		if (info) {
+			cached_info = _cache_insert (&namespace_infos, key, info);
+			if (cached_info != info)
+				g_base_info_unref (info);
+			info = cached_info;
+		}
+	}
+	_free_cache_key (buffer, key);
+	return info;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Records the function under key unless it has been recorded before; entries
+ * created while warming or before recording was enabled are recorded on their
+ * first use, too. */
+static void
+_record_usage (const gchar *key,
+               const gchar *basename,
+               const gchar *namespace,
+               const gchar *function)
+{
+	gchar **entry;
+	if (!usage_recording_enabled)
+		return;
+	G_LOCK (cache);
+	if (!recorded_usage)
+		recorded_usage = g_hash_table_new (g_str_hash, g_str_equal);
+	if (g_hash_table_lookup (recorded_usage, key)) {
+		G_UNLOCK (cache);
+		return;
+	}
+	g_hash_table_insert (recorded_usage, g_strdup (key), GINT_TO_POINTER (1));
+	entry = g_new0 (gchar *, 4);
+	entry[0] = g_strdup (basename);
+	entry[1] = g_strdup (namespace);
+	entry[2] = g_strdup (function);
+	if (!usage_manifest)
+		usage_manifest = g_ptr_array_new ();
+	g_ptr_array_add (usage_manifest, entry);
+	G_UNLOCK (cache);
+}
+
+/* Takes over the reference to info.  Returns NULL if the function's symbol
+ * cannot be found. */
+static const GPerlI11nFunctionEntry *
+_store_function_entry (const gchar *key, GIFunctionInfo *info)
+{
+	GPerlI11nFunctionEntry *entry, *cached_entry;
+	gpointer func_pointer = NULL;
+
+	if (!g_typelib_symbol (g_base_info_get_typelib ((GIBaseInfo *) info),
+	                       g_function_info_get_symbol (info),
+	                       &func_pointer))
+	{
+		g_base_info_unref ((GIBaseInfo *) info);
+		return NULL;
+	}
+
+	entry = g_new0 (GPerlI11nFunctionEntry, 1);
+	entry->info = info;
+	entry->func_pointer = func_pointer;
+	entry->plan = c_plan_new (info);
+
+	cached_entry = _cache_insert (&function_entries, key, entry);
+	if (cached_entry != entry) {
+		c_plan_free (entry->plan);
+		g_base_info_unref ((GIBaseInfo *) entry->info);
+		g_free (entry);
+	}
+	return cached_entry;
+}
+
+/* Croaks if the function cannot be found.  The entry is owned by the cache. */
+static const GPerlI11nFunctionEntry *
+get_cached_function_entry (const gchar *basename,
+                           const gchar *namespace,
+                           const gchar *function)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key;
+	const GPerlI11nFunctionEntry *entry;
+	GIFunctionInfo *info;
+
+	key = _format_cache_key (buffer, basename, namespace, function);
+	/* get_function_info croaks if there is no such function, so an
+	 * allocated key is freed when the caller's scope is left */
+	if (key != buffer)
+		SAVEDESTRUCTOR (g_free, (gchar *) key);
+	entry = _cache_lookup (function_entries, key);
+	if (!entry) {
+		info = get_function_info (g_irepository_get_default (),
+		                          basename, namespace, function);
+		entry = _store_function_entry (key, info);
+		if (!entry)
+			ccroak ("Could not locate symbol for %s%s%s",
+			        namespace ? namespace : "",
+			        namespace ? "::" : "",
+			        function);
+	}
+	_record_usage (key, basename, namespace, function);
+	return entry;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Returns a borrowed reference, or NULL if there is no such field. */
+static GIFieldInfo *
+get_cached_field_info (const gchar *basename,
+                       const gchar *namespace,
+                       const gchar *field)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key;
+	GIBaseInfo *namespace_info;
+	GIFieldInfo *info, *cached_info;
+
+	key = _format_cache_key (buffer, basename, namespace, field);
+	info = _cache_lookup (field_infos, key);
+	if (!info) {
+		namespace_info = get_cached_namespace_info (basename, namespace);
+		info = namespace_info
+			? get_field_info (namespace_info, field)
+			: NULL;
+		if (info) {
+			cached_info = _cache_insert (&field_infos, key, info);
+			if (cached_info != info)
+				g_base_info_unref (info);
+			info = cached_info;
+		}
+	}
+	_free_cache_key (buffer, key);
+	return info;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* The plan is owned by the cache. */
+static const GPerlI11nCPlan *
+get_cached_vfunc_plan (GIObjectInfo *info, GIVFuncInfo *vfunc_info)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key;
+	GPerlI11nCPlan *plan, *cached_plan;
+
+	key = _format_cache_key (buffer,
+	                         g_base_info_get_namespace (info),
+	                         g_base_info_get_name (info),
+	                         g_base_info_get_name (vfunc_info));
+	plan = _cache_lookup (vfunc_plans, key);
+	if (!plan) {
+		plan = c_plan_new (vfunc_info);
+		cached_plan = _cache_insert (&vfunc_plans, key, plan);
+		if (cached_plan != plan)
+			c_plan_free (plan);
+		plan = cached_plan;
+	}
+	_free_cache_key (buffer, key);
+	return plan;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Only successful lookups are cached since unregistered enums and flags get a
+ * GType later on. */
+static GType
+_lookup_cached_gtype (GIRegisteredTypeInfo *info)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key;
+	GType gtype;
+	key = _format_cache_key (buffer,
+	                         g_base_info_get_namespace (info),
+	                         g_base_info_get_name (info),
+	                         NULL);
+	gtype = (GType) GPOINTER_TO_SIZE (_cache_lookup (gtypes, key));
+	_free_cache_key (buffer, key);
+	return gtype;
+}
+
+static void
+_store_cached_gtype (GIRegisteredTypeInfo *info, GType gtype)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key;
+	if (!gtype || gtype == G_TYPE_NONE)
+		return;
+	key = _format_cache_key (buffer,
+	                         g_base_info_get_namespace (info),
+	                         g_base_info_get_name (info),
+	                         NULL);
+	_cache_insert (&gtypes, key, GSIZE_TO_POINTER (gtype));
+	_free_cache_key (buffer, key);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void
+_warm_methods (const gchar *basename, GIBaseInfo *info, GIInfoType info_type)
+{
+	gint i, n_methods = 0;
+
+	switch (info_type) {
+	    case GI_INFO_TYPE_OBJECT:
+		n_methods = g_object_info_get_n_methods (info);
+		break;
+	    case GI_INFO_TYPE_INTERFACE:
+		n_methods = g_interface_info_get_n_methods (info);
+		break;
+	    case GI_INFO_TYPE_BOXED:
+	    case GI_INFO_TYPE_STRUCT:
+		n_methods = g_struct_info_get_n_methods (info);
+		break;
+	    case GI_INFO_TYPE_UNION:
+		n_methods = g_union_info_get_n_methods (info);
+		break;
+	    case GI_INFO_TYPE_ENUM:
+	    case GI_INFO_TYPE_FLAGS:
+#if GI_CHECK_VERSION (1, 29, 17)
+		n_methods = g_enum_info_get_n_methods (info);
+#endif
+		break;
+	    default:
+		break;
+	}
+
+	for (i = 0; i < n_methods; i++) {
+		GIFunctionInfo *method_info = NULL;
+		gchar buffer[CACHE_KEY_SIZE];
+		const gchar *key;
+
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			method_info = g_object_info_get_method (info, i);
+			break;
+		    case GI_INFO_TYPE_INTERFACE:
+			method_info = g_interface_info_get_method (info, i);
+			break;
+		    case GI_INFO_TYPE_BOXED:
+		    case GI_INFO_TYPE_STRUCT:
+			method_info = g_struct_info_get_method (info, i);
+			break;
+		    case GI_INFO_TYPE_UNION:
+			method_info = g_union_info_get_method (info, i);
+			break;
+#if GI_CHECK_VERSION (1, 29, 17)
+		    case GI_INFO_TYPE_ENUM:
+		    case GI_INFO_TYPE_FLAGS:
+			method_info = g_enum_info_get_method (info, i);
+			break;
+#endif
+		    default:
+			g_assert_not_reached ();
+		}
+
+		key = _format_cache_key (buffer, basename,
+		                         g_base_info_get_name (info),
+		                         g_base_info_get_name (method_info));
+		/* Methods whose symbol is missing are silently skipped;
+		 * invoking them later will report the problem. */
+		if (_cache_lookup (function_entries, key))
+			g_base_info_unref (method_info);
+		else
+			_store_function_entry (key, method_info);
+		_free_cache_key (buffer, key);
+	}
+}
+
+static void
+_warm_fields (const gchar *basename, GIBaseInfo *info, GIInfoType info_type)
+{
+	gint i, n_fields;
+	n_fields = info_type == GI_INFO_TYPE_UNION
+		? g_union_info_get_n_fields ((GIUnionInfo *) info)
+		: g_struct_info_get_n_fields ((GIStructInfo *) info);
+	for (i = 0; i < n_fields; i++) {
+		GIFieldInfo *field_info = info_type == GI_INFO_TYPE_UNION
+			? g_union_info_get_field ((GIUnionInfo *) info, i)
+			: g_struct_info_get_field ((GIStructInfo *) info, i);
+		get_cached_field_info (basename,
+		                       g_base_info_get_name (info),
+		                       g_base_info_get_name (field_info));
+		g_base_info_unref (field_info);
+	}
+}
+
+/* Resolves everything that the invocation machinery will need for the given
+ * namespace: namespace infos, function infos, symbols and call plans, GTypes,
+ * enum and flags value tables and field infos. */
+static void
+warm_namespace (const gchar *basename)
+{
+	GIRepository *repository;
+	gint number, i;
+
+	repository = g_irepository_get_default ();
+	number = g_irepository_get_n_infos (repository, basename);
+	for (i = 0; i < number; i++) {
+		GIBaseInfo *info;
+		GIInfoType info_type;
+		const gchar *name;
+
+		info = g_irepository_get_info (repository, basename, i);
+		info_type = g_base_info_get_type (info);
+		name = g_base_info_get_name (info);
+
+		switch (info_type) {
+		    case GI_INFO_TYPE_FUNCTION:
+		    {
+			gchar buffer[CACHE_KEY_SIZE];
+			const gchar *key = _format_cache_key (buffer, basename, NULL, name);
+			if (!_cache_lookup (function_entries, key))
+				_store_function_entry (key, g_base_info_ref (info));
+			_free_cache_key (buffer, key);
+			break;
+		    }
+
+		    case GI_INFO_TYPE_OBJECT:
+		    case GI_INFO_TYPE_INTERFACE:
+		    case GI_INFO_TYPE_BOXED:
+		    case GI_INFO_TYPE_STRUCT:
+		    case GI_INFO_TYPE_UNION:
+		    case GI_INFO_TYPE_ENUM:
+		    case GI_INFO_TYPE_FLAGS:
+		    {
+			GType gtype;
+			get_cached_namespace_info (basename, name);
+			_warm_methods (basename, info, info_type);
+			if (info_type == GI_INFO_TYPE_BOXED ||
+			    info_type == GI_INFO_TYPE_STRUCT ||
+			    info_type == GI_INFO_TYPE_UNION)
+			{
+				_warm_fields (basename, info, info_type);
+			}
+			gtype = get_gtype ((GIRegisteredTypeInfo *) info);
+			/* Creating the value tables of enums and flags is
+			 * deferred by GObject until the class is first used,
+			 * so do it now.  The reference is never given up. */
+			if (G_TYPE_IS_ENUM (gtype) || G_TYPE_IS_FLAGS (gtype))
+				g_type_class_ref (gtype);
+			break;
+		    }
+
+		    default:
+			break;
+		}
+
+		g_base_info_unref (info);
+	}
+}
+
+/* Croaks if the function cannot be found. */
+static void
+warm_function (const gchar *basename,
+               const gchar *namespace,
+               const gchar *function)
+{
+	if (namespace)
+		get_cached_namespace_info (basename, namespace);
+	get_cached_function_entry (basename, namespace, function);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Per-container indices mapping the names of methods, fields, vfuncs and
+ * signals to their positions.  The names are owned by the typelib, which is
+ * never unloaded, so they can be used as keys directly.  Indices are stored
+ * off by one so that NULL can signal a missing entry. */
+
+typedef struct {
+	GHashTable *tables[GPERL_I11N_N_MEMBER_KINDS];
+} GPerlI11nMemberIndex;
+
+static GHashTable *member_indices = NULL;
+
+static gint
+_get_n_members (GIBaseInfo *info, GIInfoType info_type, GPerlI11nMemberKind kind)
+{
+	switch (kind) {
+	    case GPERL_I11N_MEMBER_METHOD:
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			return g_object_info_get_n_methods (info);
+		    case GI_INFO_TYPE_INTERFACE:
+			return g_interface_info_get_n_methods (info);
+		    case GI_INFO_TYPE_BOXED:
+		    case GI_INFO_TYPE_STRUCT:
+			return g_struct_info_get_n_methods (info);
+		    case GI_INFO_TYPE_UNION:
+			return g_union_info_get_n_methods (info);
+#if GI_CHECK_VERSION (1, 29, 17)
+		    case GI_INFO_TYPE_ENUM:
+		    case GI_INFO_TYPE_FLAGS:
+			return g_enum_info_get_n_methods (info);
+#endif
+		    default:
+			return 0;
+		}
+	    case GPERL_I11N_MEMBER_FIELD:
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			return g_object_info_get_n_fields (info);
+		    case GI_INFO_TYPE_BOXED:
+		    case GI_INFO_TYPE_STRUCT:
+			return g_struct_info_get_n_fields (info);
+		    case GI_INFO_TYPE_UNION:
+			return g_union_info_get_n_fields (info);
+		    default:
+			return 0;
+		}
+	    case GPERL_I11N_MEMBER_VFUNC:
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			return g_object_info_get_n_vfuncs (info);
+		    case GI_INFO_TYPE_INTERFACE:
+			return g_interface_info_get_n_vfuncs (info);
+		    default:
+			return 0;
+		}
+	    case GPERL_I11N_MEMBER_SIGNAL:
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			return g_object_info_get_n_signals (info);
+		    case GI_INFO_TYPE_INTERFACE:
+			return g_interface_info_get_n_signals (info);
+		    default:
+			return 0;
+		}
+	    default:
+		g_assert_not_reached ();
+	}
+	return 0;
+}
+
+/* Caller owns return value. */
+static GIBaseInfo *
+get_member (GIBaseInfo *info, GPerlI11nMemberKind kind, gint index)
+{
+	GIInfoType info_type = g_base_info_get_type (info);
+	switch (kind) {
+	    case GPERL_I11N_MEMBER_METHOD:
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			return g_object_info_get_method (info, index);
+		    case GI_INFO_TYPE_INTERFACE:
+			return g_interface_info_get_method (info, index);
+		    case GI_INFO_TYPE_BOXED:
+		    case GI_INFO_TYPE_STRUCT:
+			return g_struct_info_get_method (info, index);
+		    case GI_INFO_TYPE_UNION:
+			return g_union_info_get_method (info, index);
+#if GI_CHECK_VERSION (1, 29, 17)
+		    case GI_INFO_TYPE_ENUM:
+		    case GI_INFO_TYPE_FLAGS:
+			return g_enum_info_get_method (info, index);
+#endif
+		    default:
+			break;
+		}
+		break;
+	    case GPERL_I11N_MEMBER_FIELD:
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			return g_object_info_get_field (info, index);
+		    case GI_INFO_TYPE_BOXED:
+		    case GI_INFO_TYPE_STRUCT:
+			return g_struct_info_get_field (info, index);
+		    case GI_INFO_TYPE_UNION:
+			return g_union_info_get_field (info, index);
+		    default:
+			break;
+		}
+		break;
+	    case GPERL_I11N_MEMBER_VFUNC:
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			return g_object_info_get_vfunc (info, index);
+		    case GI_INFO_TYPE_INTERFACE:
+			return g_interface_info_get_vfunc (info, index);
+		    default:
+			break;
+		}
+		break;
+	    case GPERL_I11N_MEMBER_SIGNAL:
+		switch (info_type) {
+		    case GI_INFO_TYPE_OBJECT:
+			return g_object_info_get_signal (info, index);
+		    case GI_INFO_TYPE_INTERFACE:
+			return g_interface_info_get_signal (info, index);
+		    default:
+			break;
+		}
+		break;
+	    default:
+		break;
+	}
+	g_assert_not_reached ();
+	return NULL;
+}
+
+static GPerlI11nMemberIndex *
+_build_member_index (GIBaseInfo *info)
+{
+	GPerlI11nMemberIndex *index;
+	GIInfoType info_type;
+	gint kind;
+
+	index = g_new0 (GPerlI11nMemberIndex, 1);
+	info_type = g_base_info_get_type (info);
+	for (kind = 0; kind < GPERL_I11N_N_MEMBER_KINDS; kind++) {
+		gint n, i;
+		n = _get_n_members (info, info_type, kind);
+		if (!n)
+			continue;
+		index->tables[kind] = g_hash_table_new (g_str_hash, g_str_equal);
+		for (i = 0; i < n; i++) {
+			GIBaseInfo *member = get_member (info, kind, i);
+			const gchar *name = g_base_info_get_name (member);
+			/* Keep the first of several equally named members, as
+			 * the linear searches did. */
+			if (!g_hash_table_lookup (index->tables[kind], name))
+				g_hash_table_insert (index->tables[kind],
+				                     (gpointer) name,
+				                     GINT_TO_POINTER (i + 1));
+			g_base_info_unref (member);
+		}
+	}
+	return index;
+}
+
+static void
+_free_member_index (GPerlI11nMemberIndex *index)
+{
+	gint kind;
+	for (kind = 0; kind < GPERL_I11N_N_MEMBER_KINDS; kind++)
+		if (index->tables[kind])
+			g_hash_table_destroy (index->tables[kind]);
+	g_free (index);
+}
+
+/* Returns the position of the member called name in the container info, or -1
+ * if there is no such member. */
+static gint
+find_member_index (GIBaseInfo *info, GPerlI11nMemberKind kind, const gchar *name)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key;
+	GPerlI11nMemberIndex *index, *cached_index;
+	GHashTable *table;
+	gint position;
+
+	key = _format_cache_key (buffer,
+	                         g_base_info_get_namespace (info),
+	                         g_base_info_get_name (info),
+	                         NULL);
+	index = _cache_lookup (member_indices, key);
+	if (!index) {
+		index = _build_member_index (info);
+		cached_index = _cache_insert (&member_indices, key, index);
+		if (cached_index != index) {
+			_free_member_index (index);
+			index = cached_index;
+		}
+	}
+	_free_cache_key (buffer, key);
+
+	table = index->tables[kind];
+	/* Once built, the index is never modified, so we can read it without
+	 * holding the lock. */
+	position = table ? GPOINTER_TO_INT (g_hash_table_lookup (table, name)) : 0;
+	return position - 1;
+}
+
+/* Caller owns return value, which is NULL if there is no such member. */
+static GIBaseInfo *
+find_member (GIBaseInfo *info, GPerlI11nMemberKind kind, const gchar *name)
+{
+	gint index = find_member_index (info, kind, name);
+	return index >= 0 ? get_member (info, kind, index) : NULL;
+}
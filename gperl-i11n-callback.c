@@ -1,35 +1,218 @@
 /* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
 
+/* Number of ffi closures created for Perl callbacks so far.  Only used for
+ * reporting. */
+static gint n_perl_callback_closures = 0;
+
+/* Preparing an ffi closure is expensive, so closures for callback args and
+ * signal emissions are recycled: on release, the closure and its cif stay
+ * bound to the info, and the info goes back into a pool kept per callback
+ * interface.  Only the per-use state is reset. */
+
+#define CLOSURE_POOL_SIZE 16
+
+struct _GPerlI11nClosurePool {
+	guint n_free;
+	GPerlI11nPerlCallbackInfo *free[CLOSURE_POOL_SIZE];
+};
+
+G_LOCK_DEFINE_STATIC (closure_pools);
+
+static GHashTable *closure_pools = NULL;
+
+/* Returns NULL if cb_info cannot be identified by name. */
+static GPerlI11nClosurePool *
+_get_closure_pool (GICallableInfo *cb_info)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key, *name;
+	GIBaseInfo *container;
+	GPerlI11nClosurePool *pool;
+
+	name = g_base_info_get_name (cb_info);
+	if (!name)
+		return NULL;
+	/* Signals are only unique within their container. */
+	container = g_base_info_get_container (cb_info);
+	key = _format_cache_key (buffer,
+	                         g_base_info_get_namespace (cb_info),
+	                         container ? g_base_info_get_name (container) : NULL,
+	                         name);
+	pool = _cache_lookup (closure_pools, key);
+	if (!pool) {
+		GPerlI11nClosurePool *cached_pool;
+		pool = g_new0 (GPerlI11nClosurePool, 1);
+		cached_pool = _cache_insert (&closure_pools, key, pool);
+		if (cached_pool != pool) {
+			g_free (pool);
+			pool = cached_pool;
+		}
+	}
+	_free_cache_key (buffer, key);
+	return pool;
+}
+
 static GPerlI11nPerlCallbackInfo *
-create_perl_callback_closure (GICallableInfo *cb_info, SV *code)
+_closure_pool_pop (GPerlI11nClosurePool *pool)
 {
-	GPerlI11nPerlCallbackInfo *info;
+	GPerlI11nPerlCallbackInfo *info = NULL;
+	G_LOCK (closure_pools);
+	if (pool->n_free > 0)
+		info = pool->free[--pool->n_free];
+	G_UNLOCK (closure_pools);
+	return info;
+}
 
-	info = g_new0 (GPerlI11nPerlCallbackInfo, 1);
-	if (!gperl_sv_is_defined (code))
-		return info;
+/* Returns FALSE if the pool is full. */
+static gboolean
+_closure_pool_push (GPerlI11nClosurePool *pool, GPerlI11nPerlCallbackInfo *info)
+{
+	gboolean pushed = FALSE;
+	G_LOCK (closure_pools);
+	if (pool->n_free < CLOSURE_POOL_SIZE) {
+		pool->free[pool->n_free++] = info;
+		pushed = TRUE;
+	}
+	G_UNLOCK (closure_pools);
+	return pushed;
+}
 
-	info->interface = g_base_info_ref (cb_info);
+static void
+_prepare_perl_callback_closure (GPerlI11nPerlCallbackInfo *info)
+{
+	g_atomic_int_inc (&n_perl_callback_closures);
 	info->cif = g_new0 (ffi_cif, 1);
 
 #if GI_CHECK_VERSION (1, 72, 0)
-        info->closure =
-                g_callable_info_create_closure (info->interface,
-                                                info->cif,
-                                                invoke_perl_code,
-                                                info);
+	info->closure =
+		g_callable_info_create_closure (info->interface,
+		                                info->cif,
+		                                invoke_perl_code,
+		                                info);
 #else
-        G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 	info->closure =
 		g_callable_info_prepare_closure (info->interface,
-                                                 info->cif,
+		                                 info->cif,
 		                                 invoke_perl_code,
-                                                 info);
-        G_GNUC_END_IGNORE_DEPRECATIONS
+		                                 info);
+	G_GNUC_END_IGNORE_DEPRECATIONS
 #endif
-	/* FIXME: This should most likely use SvREFCNT_inc instead of
-	 * newSVsv. */
-	info->code = newSVsv (code);
+}
+
+/* Resets the per-use state of a pooled info. */
+static void
+_reset_perl_callback_info (GPerlI11nPerlCallbackInfo *info)
+{
+	if (info->code)
+		SvREFCNT_dec (info->code);
+	if (info->data)
+		SvREFCNT_dec (info->data);
+	if (info->args_converter)
+		SvREFCNT_dec (info->args_converter);
+	info->code = NULL;
+	info->data = NULL;
+	info->args_converter = NULL;
+	info->swap_data = FALSE;
+	info->data_pos = -1;
+	info->destroy_pos = -1;
+	info->free_after_use = FALSE;
+	clear_resolved_methods (info);
+}
+
+/* Async-scoped callbacks are invoked once and then released.  They cannot be
+ * released from within their invocation since ffi still uses the closure
+ * while returning, so _invoke_perl_code hands them to
+ * finish_async_perl_callback, and they are released at the next safe point:
+ * when another callback closure is created or invoked, or when the counts
+ * are queried.  This assumes that an async callback is not invoked from one
+ * thread while another thread reaches a safe point. */
+
+G_LOCK_DEFINE_STATIC (async_callbacks);
+
+static GSList *finished_async_callbacks = NULL;
+static gint n_live_async_callbacks = 0;
+static gint n_released_async_callbacks = 0;
+
+static void
+register_async_perl_callback (GPerlI11nPerlCallbackInfo *info)
+{
+	info->free_after_use = TRUE;
+	g_atomic_int_inc (&n_live_async_callbacks);
+}
+
+static void
+finish_async_perl_callback (GPerlI11nPerlCallbackInfo *info)
+{
+	G_LOCK (async_callbacks);
+	finished_async_callbacks =
+		g_slist_prepend (finished_async_callbacks, info);
+	G_UNLOCK (async_callbacks);
+}
+
+static void
+release_finished_async_perl_callbacks (void)
+{
+	GSList *finished = NULL, *l, *next;
+#ifdef PERL_IMPLICIT_CONTEXT
+	gpointer perl_context = aTHX;
+#else
+	gpointer perl_context = NULL;
+#endif
+
+	if (!g_atomic_pointer_get (&finished_async_callbacks))
+		return;
+
+	/* Only take the callbacks of the current interpreter; the others'
+	 * SVs must not be touched from here. */
+	G_LOCK (async_callbacks);
+	for (l = finished_async_callbacks; l != NULL; l = next) {
+		next = l->next;
+		if (((GPerlI11nPerlCallbackInfo *) l->data)->priv != perl_context)
+			continue;
+		finished_async_callbacks =
+			g_slist_remove_link (finished_async_callbacks, l);
+		finished = g_slist_concat (l, finished);
+	}
+	G_UNLOCK (async_callbacks);
+
+	for (l = finished; l != NULL; l = l->next) {
+		dwarn ("releasing async callback %p\n", l->data);
+		release_perl_callback (l->data);
+		g_atomic_int_add (&n_live_async_callbacks, -1);
+		g_atomic_int_inc (&n_released_async_callbacks);
+	}
+	g_slist_free (finished);
+}
+
+static GPerlI11nPerlCallbackInfo *
+create_perl_callback_closure (GICallableInfo *cb_info, SV *code)
+{
+	GPerlI11nPerlCallbackInfo *info = NULL;
+	GPerlI11nClosurePool *pool;
+
+	release_finished_async_perl_callbacks ();
+
+	if (!gperl_sv_is_defined (code))
+		return g_new0 (GPerlI11nPerlCallbackInfo, 1);
+
+	pool = _get_closure_pool (cb_info);
+	if (pool)
+		info = _closure_pool_pop (pool);
+	if (!info) {
+		info = g_new0 (GPerlI11nPerlCallbackInfo, 1);
+		info->interface = g_base_info_ref (cb_info);
+		info->pool = pool;
+		_prepare_perl_callback_closure (info);
+	}
+
+	/* Hold on to the sub itself rather than copying the reference to it.
+	 * Anything else, like a sub name, is copied so that later changes to
+	 * the caller's variable do not affect us. */
+	if (SvROK (code) && SvTYPE (SvRV (code)) == SVt_PVCV)
+		info->code = SvREFCNT_inc (SvRV (code));
+	else
+		info->code = newSVsv (code);
 	info->sub_name = NULL;
 
 	/* These are only relevant for signal marshalling; if needed, they get
@@ -47,7 +230,9 @@ create_perl_callback_closure (GICallableInfo *cb_info, SV *code)
 static void
 attach_perl_callback_data (GPerlI11nPerlCallbackInfo *info, SV *data)
 {
-	/* FIXME: SvREFCNT_inc? */
+	/* data usually comes straight from the caller's argument list, so it
+	 * needs to be copied: the caller might still modify the variable it
+	 * lives in. */
 	info->data = newSVsv (data);
 }
 
@@ -59,23 +244,7 @@ create_perl_callback_closure_for_named_sub (GICallableInfo *cb_info, gchar *sub_
 
 	info = g_new0 (GPerlI11nPerlCallbackInfo, 1);
 	info->interface = g_base_info_ref (cb_info);
-	info->cif = g_new0 (ffi_cif, 1);
-
-#if GI_CHECK_VERSION (1, 72, 0)
-	info->closure =
-		g_callable_info_create_closure (info->interface,
-                                                info->cif,
-		                                invoke_perl_code,
-                                                info);
-#else
-        G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-	info->closure =
-		g_callable_info_prepare_closure (info->interface,
-                                                 info->cif,
-		                                 invoke_perl_code,
-                                                 info);
-        G_GNUC_END_IGNORE_DEPRECATIONS
-#endif
+	_prepare_perl_callback_closure (info);
 
 	info->sub_name = sub_name;
 	info->code = NULL;
@@ -88,12 +257,87 @@ create_perl_callback_closure_for_named_sub (GICallableInfo *cb_info, gchar *sub_
 	return info;
 }
 
+/* Vfunc closures dispatch by method name on the invocant, so one closure per
+ * vfunc and method name can be shared by all classes implementing the vfunc.
+ * Since the closure calls into the interpreter that created it, each
+ * interpreter has its own set, kept in MY_CXT and keyed by the vfunc's
+ * container and the method name.  The closures are kept forever, as class
+ * structs point to them. */
+
+/* The returned info is owned by the cache. */
+static GPerlI11nPerlCallbackInfo *
+get_shared_perl_callback_closure_for_vfunc (GIBaseInfo *container_info,
+                                            GICallableInfo *cb_info,
+                                            const gchar *sub_name)
+{
+	gchar buffer[CACHE_KEY_SIZE];
+	const gchar *key;
+	GPerlI11nPerlCallbackInfo *info;
+	dMY_CXT;
+
+	key = _format_cache_key (buffer,
+	                         g_base_info_get_namespace (container_info),
+	                         g_base_info_get_name (container_info),
+	                         sub_name);
+	info = g_hash_table_lookup (MY_CXT.vfunc_closures, key);
+	if (!info) {
+		info = create_perl_callback_closure_for_named_sub (
+		         cb_info, g_strdup (sub_name));
+		g_hash_table_insert (MY_CXT.vfunc_closures, g_strdup (key), info);
+	}
+	_free_cache_key (buffer, key);
+	return info;
+}
+
+/* Infos are pinned while invocations from other threads are queued for them,
+ * see gperl-i11n-dispatch.c. */
+
+G_LOCK_DEFINE_STATIC (pinned_callbacks);
+
+static void
+pin_perl_callback (GPerlI11nPerlCallbackInfo *info)
+{
+	G_LOCK (pinned_callbacks);
+	info->n_pins++;
+	G_UNLOCK (pinned_callbacks);
+}
+
+/* Must be called on the thread of the info's interpreter. */
+static void
+unpin_perl_callback (GPerlI11nPerlCallbackInfo *info)
+{
+	gboolean release;
+	G_LOCK (pinned_callbacks);
+	info->n_pins--;
+	release = info->n_pins == 0 && info->release_pending;
+	if (release)
+		info->release_pending = FALSE;
+	G_UNLOCK (pinned_callbacks);
+	if (release)
+		release_perl_callback (info);
+}
+
 static void
 release_perl_callback (gpointer data)
 {
 	GPerlI11nPerlCallbackInfo *info = data;
 	dwarn ("info = %p\n", info);
 
+	G_LOCK (pinned_callbacks);
+	if (info->n_pins > 0) {
+		dwarn ("deferring the release of pinned info %p\n", info);
+		info->release_pending = TRUE;
+		G_UNLOCK (pinned_callbacks);
+		return;
+	}
+	G_UNLOCK (pinned_callbacks);
+
+	if (info->pool) {
+		_reset_perl_callback_info (info);
+		if (_closure_pool_push (info->pool, info))
+			return;
+	}
+
 	/* g_callable_info_free_closure reaches into info->cif, so it needs to
 	 * be called before we free it.  See
 	 * <https://bugzilla.gnome.org/show_bug.cgi?id=652954>. */
@@ -109,6 +353,10 @@ release_perl_callback (gpointer data)
 	if (info->cif)
 		g_free (info->cif);
 
+	if (info->plan)
+		perl_plan_free (info->plan);
+	if (info->comparator)
+		comparator_free (info->comparator);
 	if (info->interface)
 		g_base_info_unref ((GIBaseInfo*) info->interface);
 
@@ -118,9 +366,12 @@ release_perl_callback (gpointer data)
 		SvREFCNT_dec (info->data);
 	if (info->sub_name)
 		g_free (info->sub_name);
+	clear_resolved_methods (info);
 
 	if (info->args_converter)
 		SvREFCNT_dec (info->args_converter);
+	if (info->future)
+		SvREFCNT_dec (info->future);
 
 	g_free (info);
 }
@@ -161,6 +412,8 @@ release_c_callback (gpointer data)
 	/* if (info->destroy) */
 	/* 	info->destroy (info->data); */
 
+	if (info->plan)
+		c_plan_free (info->plan);
 	if (info->interface)
 		g_base_info_unref (info->interface);
 
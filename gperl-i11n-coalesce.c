@@ -0,0 +1,125 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+/* Coalesced callbacks: a Glib::Object::Introspection::Coalesced wraps a
+ * handler that is to receive the args of many invocations at once.  The
+ * converted args of each invocation are queued in the object, and a flush on
+ * the main context that was the thread-default one when the first of them was
+ * queued hands them to the handler, unless max_events invocations have been
+ * queued before. */
+
+#define COALESCED_PACKAGE "Glib::Object::Introspection::Coalesced"
+
+typedef struct {
+	SV *coalesced;
+	gpointer priv;
+} GPerlI11nCoalescedFlush;
+
+static gboolean
+is_coalesced_sv (SV *sv)
+{
+	/* plain code refs are not objects, so they are quickly rejected */
+	return sv && SvROK (sv) && SvOBJECT (SvRV (sv)) &&
+	       sv_derived_from (sv, COALESCED_PACKAGE);
+}
+
+/* Whether invocations of cb_info need anything handed back, in which case they
+ * cannot be coalesced. */
+static gboolean
+callable_has_results (GICallableInfo *cb_info)
+{
+	GITypeInfo return_type;
+	GIArgInfo arg_info;
+	gint i;
+
+	g_callable_info_load_return_type (cb_info, &return_type);
+	if (g_type_info_get_tag (&return_type) != GI_TYPE_TAG_VOID ||
+	    g_type_info_is_pointer (&return_type))
+		return TRUE;
+	for (i = 0; i < g_callable_info_get_n_args (cb_info); i++) {
+		g_callable_info_load_arg (cb_info, i, &arg_info);
+		if (g_arg_info_get_direction (&arg_info) != GI_DIRECTION_IN)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+_flush_coalesced (SV *coalesced)
+{
+	HV *hv = (HV *) SvRV (coalesced);
+	SV *pending, **code;
+	dSP;
+
+	pending = hv_deletes (hv, "pending", 0);
+	code = hv_fetchs (hv, "code", 0);
+	if (!pending || !code)
+		return;
+
+	ENTER;
+	SAVETMPS;
+	PUSHMARK (SP);
+	XPUSHs (pending); /* mortal already */
+	PUTBACK;
+	call_sv (*code, G_DISCARD | G_EVAL);
+	if (SvTRUE (ERRSV))
+		gperl_run_exception_handlers ();
+	FREETMPS;
+	LEAVE;
+}
+
+static gboolean
+_flush_coalesced_source (gpointer data)
+{
+	GPerlI11nCoalescedFlush *flush = data;
+	dTHXa (flush->priv);
+	(void) hv_deletes ((HV *) SvRV (flush->coalesced), "scheduled", G_DISCARD);
+	_flush_coalesced (flush->coalesced);
+	SvREFCNT_dec (flush->coalesced);
+	g_free (flush);
+	return G_SOURCE_REMOVE;
+}
+
+/* Takes the args that are on the stack above the topmost mark and queues them
+ * as one tuple. */
+static void
+queue_coalesced_args (SV *coalesced)
+{
+	HV *hv = (HV *) SvRV (coalesced);
+	SV **svp;
+	AV *pending, *tuple;
+	IV max_events;
+	dSP;
+	dMARK;
+
+	tuple = av_make ((SSize_t) (SP - MARK), MARK + 1);
+	SP = MARK;
+	PUTBACK;
+
+	svp = hv_fetchs (hv, "pending", 0);
+	if (svp && gperl_sv_is_array_ref (*svp)) {
+		pending = (AV *) SvRV (*svp);
+	} else {
+		pending = newAV ();
+		(void) hv_stores (hv, "pending", newRV_noinc ((SV *) pending));
+	}
+	av_push (pending, newRV_noinc ((SV *) tuple));
+
+	svp = hv_fetchs (hv, "max_events", 0);
+	max_events = svp ? SvIV (*svp) : 0;
+	if (max_events > 0 && av_len (pending) + 1 >= max_events) {
+		_flush_coalesced (coalesced);
+	} else if (!hv_exists (hv, "scheduled", strlen ("scheduled"))) {
+		GPerlI11nCoalescedFlush *flush = g_new0 (GPerlI11nCoalescedFlush, 1);
+		GSource *source;
+		(void) hv_stores (hv, "scheduled", newSViv (1));
+		flush->coalesced = SvREFCNT_inc (coalesced);
+#ifdef PERL_IMPLICIT_CONTEXT
+		flush->priv = aTHX;
+#endif
+		source = g_idle_source_new ();
+		g_source_set_priority (source, G_PRIORITY_DEFAULT);
+		g_source_set_callback (source, _flush_coalesced_source, flush, NULL);
+		g_source_attach (source, g_main_context_get_thread_default ());
+		g_source_unref (source);
+	}
+}
@@ -0,0 +1,310 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+/* Declarative comparators: instead of a code ref, a
+ * Glib::Object::Introspection::Comparator can be passed for callbacks that
+ * compare two objects.  It describes a sort key -- an object property or the
+ * result of a Perl sub -- and how keys are ordered.  The callback is then
+ * implemented natively.  For call-scoped callbacks, each element's key is
+ * computed only once and kept in a table for the duration of the call. */
+
+#define COMPARATOR_PACKAGE "Glib::Object::Introspection::Comparator"
+
+typedef struct {
+	gdouble number;
+	gchar *string;
+} GPerlI11nSortKey;
+
+struct _GPerlI11nComparator {
+	gchar *property;
+	SV *key_func;
+	gboolean numeric;
+	gboolean reverse;
+
+	/* element => GPerlI11nSortKey; NULL if keys are not to be kept */
+	GHashTable *keys;
+};
+
+static gboolean
+is_comparator_sv (SV *sv)
+{
+	return sv_isobject (sv) && sv_derived_from (sv, COMPARATOR_PACKAGE);
+}
+
+static void
+_free_sort_key (gpointer data)
+{
+	GPerlI11nSortKey *key = data;
+	g_free (key->string);
+	g_free (key);
+}
+
+/* Checks that cb_info has the shape of a comparison function: an integer
+ * return value and two pointer args first. */
+static gboolean
+_is_comparison_callable (GICallableInfo *cb_info)
+{
+	GITypeInfo type_info;
+	GIArgInfo arg_info;
+	gint i;
+
+	g_callable_info_load_return_type (cb_info, &type_info);
+	if (g_type_info_get_tag (&type_info) != GI_TYPE_TAG_INT32)
+		return FALSE;
+	if (g_callable_info_get_n_args (cb_info) < 2)
+		return FALSE;
+	for (i = 0; i < 2; i++) {
+		g_callable_info_load_arg (cb_info, i, &arg_info);
+		g_arg_info_load_type (&arg_info, &type_info);
+		if (!g_type_info_is_pointer (&type_info))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static struct _GPerlI11nComparator *
+_comparator_new (SV *sv, gboolean keep_keys)
+{
+	struct _GPerlI11nComparator *comparator;
+	HV *hv = (HV *) SvRV (sv);
+	SV **svp;
+
+	comparator = g_new0 (struct _GPerlI11nComparator, 1);
+
+	svp = hv_fetchs (hv, "property", 0);
+	if (svp && gperl_sv_is_defined (*svp))
+		comparator->property = g_strdup (SvPV_nolen (*svp));
+	svp = hv_fetchs (hv, "key", 0);
+	if (svp && gperl_sv_is_defined (*svp))
+		comparator->key_func = newSVsv (*svp);
+	if (!comparator->property == !comparator->key_func) {
+		if (comparator->key_func)
+			SvREFCNT_dec (comparator->key_func);
+		g_free (comparator->property);
+		g_free (comparator);
+		ccroak ("A comparator needs either a property or a key function");
+	}
+
+	svp = hv_fetchs (hv, "compare", 0);
+	comparator->numeric =
+		svp && gperl_sv_is_defined (*svp) &&
+		strEQ (SvPV_nolen (*svp), "numeric");
+	svp = hv_fetchs (hv, "reverse", 0);
+	comparator->reverse = svp && SvTRUE (*svp);
+
+	if (keep_keys)
+		comparator->keys = g_hash_table_new_full (g_direct_hash,
+		                                          g_direct_equal,
+		                                          NULL,
+		                                          _free_sort_key);
+
+	return comparator;
+}
+
+static void
+comparator_free (struct _GPerlI11nComparator *comparator)
+{
+	g_free (comparator->property);
+	if (comparator->key_func)
+		SvREFCNT_dec (comparator->key_func);
+	if (comparator->keys)
+		g_hash_table_destroy (comparator->keys);
+	g_free (comparator);
+}
+
+static void
+_compute_property_key (struct _GPerlI11nComparator *comparator,
+                       gpointer element,
+                       GPerlI11nSortKey *key)
+{
+	GValue value = G_VALUE_INIT, transformed = G_VALUE_INIT;
+	GParamSpec *pspec;
+	GType key_type = comparator->numeric ? G_TYPE_DOUBLE : G_TYPE_STRING;
+
+	/* All checks happen before any value is set up, so that nothing is
+	 * leaked when they croak. */
+	if (!G_IS_OBJECT (element))
+		ccroak ("Comparator on property '%s' encountered a non-object",
+		        comparator->property);
+	pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+	                                      comparator->property);
+	if (!pspec)
+		ccroak ("Comparator: %s has no property '%s'",
+		        G_OBJECT_TYPE_NAME (element), comparator->property);
+	if (!g_value_type_transformable (G_PARAM_SPEC_VALUE_TYPE (pspec),
+	                                 key_type))
+		ccroak ("Comparator: cannot compare property '%s' of type %s %s",
+		        comparator->property,
+		        g_type_name (G_PARAM_SPEC_VALUE_TYPE (pspec)),
+		        comparator->numeric ? "numerically" : "as a string");
+
+	g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+	g_object_get_property (element, comparator->property, &value);
+	g_value_init (&transformed, key_type);
+	g_value_transform (&value, &transformed);
+	if (comparator->numeric)
+		key->number = g_value_get_double (&transformed);
+	else
+		key->string = g_value_dup_string (&transformed);
+	g_value_unset (&transformed);
+	g_value_unset (&value);
+}
+
+static void
+_compute_perl_key (GPerlI11nPerlCallbackInfo *info,
+                   gpointer element,
+                   GPerlI11nSortKey *key)
+{
+	struct _GPerlI11nComparator *comparator = info->comparator;
+	SV *element_sv, *key_sv;
+	dGPERL_CALLBACK_MARSHAL_SP;
+
+	GPERL_CALLBACK_MARSHAL_INIT (info);
+
+	ENTER;
+	SAVETMPS;
+
+	element_sv = G_IS_OBJECT (element)
+		? gperl_new_object (element, FALSE)
+		: newSVuv (PTR2UV (element));
+	PUSHMARK (SP);
+	XPUSHs (sv_2mortal (element_sv));
+	PUTBACK;
+	if (call_sv (comparator->key_func, G_SCALAR) != 1)
+		ccroak ("Comparator key function did not return a value");
+	SPAGAIN;
+	key_sv = POPs;
+	if (comparator->numeric)
+		key->number = SvNV (key_sv);
+	else
+		key->string = g_strdup (SvPVutf8_nolen (key_sv));
+	PUTBACK;
+
+	FREETMPS;
+	LEAVE;
+}
+
+/* Returns the key for element, computing and possibly storing it.  It is
+ * computed into scratch, which the caller frees even if this croaks, and only
+ * moved to the heap once it is complete. */
+static const GPerlI11nSortKey *
+_get_sort_key (GPerlI11nPerlCallbackInfo *info,
+               gpointer element,
+               GPerlI11nSortKey *scratch)
+{
+	struct _GPerlI11nComparator *comparator = info->comparator;
+	GPerlI11nSortKey *key;
+
+	if (comparator->keys) {
+		key = g_hash_table_lookup (comparator->keys, element);
+		if (key)
+			return key;
+	}
+
+	if (comparator->property)
+		_compute_property_key (comparator, element, scratch);
+	else
+		_compute_perl_key (info, element, scratch);
+
+	if (!comparator->keys)
+		return scratch;
+
+	key = g_new (GPerlI11nSortKey, 1);
+	*key = *scratch;
+	scratch->string = NULL;
+	g_hash_table_insert (comparator->keys, element, key);
+	return key;
+}
+
+typedef struct {
+	GPerlI11nPerlCallbackInfo *info;
+	GPerlI11nSortKey scratch_a;
+	GPerlI11nSortKey scratch_b;
+} GPerlI11nComparison;
+
+/* Runs when a comparison is done, even if computing a key croaked. */
+static void
+_finish_comparison (pTHX_ void *data)
+{
+	GPerlI11nComparison *comparison = data;
+	PERL_UNUSED_CONTEXT;
+	g_free (comparison->scratch_a.string);
+	g_free (comparison->scratch_b.string);
+	/* async-scoped callbacks are invoked once */
+	if (comparison->info->free_after_use)
+		finish_async_perl_callback (comparison->info);
+}
+
+static void
+invoke_native_comparator (ffi_cif *cif, gpointer resp, gpointer *args, gpointer userdata)
+{
+	GPerlI11nPerlCallbackInfo *info = userdata;
+	GPerlI11nComparison comparison = { NULL, { 0, NULL }, { 0, NULL } };
+	const GPerlI11nSortKey *a, *b;
+	gint result;
+	dTHXa (info->priv);
+
+	PERL_UNUSED_VAR (cif);
+
+	ENTER;
+	comparison.info = info;
+	SAVEDESTRUCTOR_X (_finish_comparison, &comparison);
+
+	a = _get_sort_key (info, CAST_RAW (args[0], gpointer),
+	                   &comparison.scratch_a);
+	b = _get_sort_key (info, CAST_RAW (args[1], gpointer),
+	                   &comparison.scratch_b);
+	if (info->comparator->numeric)
+		result = (a->number > b->number) - (a->number < b->number);
+	else
+		result = g_strcmp0 (a->string, b->string);
+	if (info->comparator->reverse)
+		result = -result;
+
+	LEAVE;
+
+	*((ffi_sarg *) resp) = result;
+}
+
+/* Creates a callback info whose closure compares natively as described by
+ * sv.  It is released with release_perl_callback like all others. */
+static GPerlI11nPerlCallbackInfo *
+create_native_comparator_closure (GICallableInfo *cb_info, SV *sv, gboolean keep_keys)
+{
+	GPerlI11nPerlCallbackInfo *info;
+
+	if (!_is_comparison_callable (cb_info))
+		ccroak ("A %s can only be used for callbacks of the form "
+		        "'gint compare (gpointer a, gpointer b, ...)', not for %s",
+		        COMPARATOR_PACKAGE, g_base_info_get_name (cb_info));
+
+	info = g_new0 (GPerlI11nPerlCallbackInfo, 1);
+	info->comparator = _comparator_new (sv, keep_keys);
+	info->interface = g_base_info_ref (cb_info);
+	info->cif = g_new0 (ffi_cif, 1);
+#if GI_CHECK_VERSION (1, 72, 0)
+	info->closure =
+		g_callable_info_create_closure (info->interface,
+		                                info->cif,
+		                                invoke_native_comparator,
+		                                info);
+#else
+	G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	info->closure =
+		g_callable_info_prepare_closure (info->interface,
+		                                 info->cif,
+		                                 invoke_native_comparator,
+		                                 info);
+	G_GNUC_END_IGNORE_DEPRECATIONS
+#endif
+	/* Marks the info as having code, so that destroy notifies get
+	 * installed. */
+	info->code = newSVsv (sv);
+	info->data_pos = -1;
+	info->destroy_pos = -1;
+
+#ifdef PERL_IMPLICIT_CONTEXT
+	info->priv = aTHX;
+#endif
+
+	return info;
+}
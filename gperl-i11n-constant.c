@@ -0,0 +1,56 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+static SV *
+constant_to_sv (GIConstantInfo *info)
+{
+	GITypeInfo *type_info;
+	GIArgument value = {0,};
+	SV *sv;
+
+	type_info = g_constant_info_get_type (info);
+	/* FIXME: What am I suppossed to do with the return value? */
+	g_constant_info_get_value (info, &value);
+	sv = arg_to_sv (&value,
+	                type_info,
+	                GI_TRANSFER_NOTHING,
+	                GPERL_I11N_MEMORY_SCOPE_IRRELEVANT,
+	                NULL);
+#if GI_CHECK_VERSION (1, 30, 1)
+	g_constant_info_free_value (info, &value);
+#endif
+	g_base_info_unref ((GIBaseInfo *) type_info);
+
+	return sv;
+}
+
+/* Turns every entry of sub_names, which maps constant names to fully qualified
+ * sub names, into a constant sub.  Since these are proper constant subs, perl
+ * can inline their values at every call site compiled afterwards. */
+static void
+install_constants (const gchar *basename, HV *sub_names)
+{
+	GIRepository *repository;
+	HE *he;
+
+	repository = g_irepository_get_default ();
+	hv_iterinit (sub_names);
+	while ((he = hv_iternext (sub_names))) {
+		I32 name_length;
+		const gchar *name = hv_iterkey (he, &name_length);
+		const gchar *sub_name = SvPV_nolen (hv_iterval (sub_names, he));
+		GIBaseInfo *info;
+		SV *value;
+
+		info = g_irepository_find_by_name (repository, basename, name);
+		if (!info || !GI_IS_CONSTANT_INFO (info)) {
+			if (info)
+				g_base_info_unref (info);
+			ccroak ("%s is not a constant", name);
+		}
+		value = constant_to_sv ((GIConstantInfo *) info);
+		g_base_info_unref (info);
+
+		dwarn ("%s = %s\n", sub_name, SvPV_nolen (value));
+		newCONSTSUB (NULL, sub_name, value);
+	}
+}
@@ -0,0 +1,194 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+/* Declarative args conversions for the generic signal marshaller: instead of
+ * a code ref, an array ref can be given that lists the args the handler is to
+ * receive.  Each entry is either the position of an arg -- 0 being the
+ * instance and 1 the first signal arg -- or an array ref holding such a
+ * position followed by options:
+ *
+ *   field => NAME      pass the field NAME of the struct arg instead
+ *   package => NAME    convert an integer into a nick of the enum or flags
+ *                      type registered for the package NAME
+ *
+ * Args that are not listed are dropped.  The spec is compiled into the
+ * signal's plan, and conversions then happen without calling Perl code. */
+
+typedef struct {
+	guint pos;
+	GIFieldInfo *field;
+	/* an enum or flags type, or 0 */
+	GType package_type;
+} GPerlI11nConversionSlot;
+
+struct _GPerlI11nArgsConversion {
+	guint n_slots;
+	GPerlI11nConversionSlot *slots;
+};
+
+static void
+args_conversion_free (struct _GPerlI11nArgsConversion *conversion)
+{
+	guint i;
+	for (i = 0; i < conversion->n_slots; i++)
+		if (conversion->slots[i].field)
+			g_base_info_unref (conversion->slots[i].field);
+	g_free (conversion->slots);
+	g_free (conversion);
+}
+
+/* Returns a new reference to the field info, or NULL if the arg at pos does
+ * not have a field of that name. */
+static GIFieldInfo *
+_find_conversion_field (GISignalInfo *signal_info, guint pos, const gchar *name)
+{
+	GIArgInfo arg_info;
+	GITypeInfo type_info;
+	GIBaseInfo *interface;
+	GIFieldInfo *field = NULL;
+
+	if (pos == 0)
+		return NULL; /* the instance is an object */
+	g_callable_info_load_arg (signal_info, pos - 1, &arg_info);
+	g_arg_info_load_type (&arg_info, &type_info);
+	if (g_type_info_get_tag (&type_info) != GI_TYPE_TAG_INTERFACE)
+		return NULL;
+	interface = g_type_info_get_interface (&type_info);
+	field = get_field_info (interface, name);
+	g_base_info_unref (interface);
+	return field;
+}
+
+static void
+_compile_conversion_slot (GISignalInfo *signal_info,
+                          SV *entry,
+                          GPerlI11nConversionSlot *slot)
+{
+	guint n_positions = g_callable_info_get_n_args (signal_info) + 1;
+	SV *pos_sv = entry;
+	AV *av = NULL;
+	gint i, n = 0;
+
+	if (gperl_sv_is_array_ref (entry)) {
+		SV **svp;
+		av = (AV *) SvRV (entry);
+		n = av_len (av) + 1;
+		svp = av_fetch (av, 0, 0);
+		pos_sv = svp ? *svp : NULL;
+	}
+	if (!pos_sv || !looks_like_number (pos_sv) ||
+	    SvIV (pos_sv) < 0 || SvIV (pos_sv) >= (IV) n_positions)
+		ccroak ("Args conversion for signal %s: invalid arg position; "
+		        "use 0 for the instance and 1 to %u for the args",
+		        g_base_info_get_name (signal_info), n_positions - 1);
+	slot->pos = (guint) SvIV (pos_sv);
+
+	if (av && n % 2 != 1)
+		ccroak ("Args conversion for signal %s: options must come in "
+		        "name => value pairs",
+		        g_base_info_get_name (signal_info));
+	for (i = 1; i < n; i += 2) {
+		const gchar *key = SvPV_nolen (*av_fetch (av, i, 0));
+		const gchar *value = SvPV_nolen (*av_fetch (av, i + 1, 0));
+		if (strEQ (key, "field")) {
+			slot->field = _find_conversion_field (signal_info,
+			                                      slot->pos, value);
+			if (!slot->field)
+				ccroak ("Args conversion for signal %s: "
+				        "arg %u has no field '%s'",
+				        g_base_info_get_name (signal_info),
+				        slot->pos, value);
+		} else if (strEQ (key, "package")) {
+			/* Only values are converted: reblessing references
+			 * would change the shared wrappers of objects. */
+			GType gtype = gperl_type_from_package (value);
+			if (!gtype ||
+			    !(G_TYPE_IS_ENUM (gtype) || G_TYPE_IS_FLAGS (gtype)))
+				ccroak ("Args conversion for signal %s: "
+				        "%s is not an enum or flags type",
+				        g_base_info_get_name (signal_info),
+				        value);
+			slot->package_type = gtype;
+		} else {
+			ccroak ("Args conversion for signal %s: "
+			        "unknown option '%s'",
+			        g_base_info_get_name (signal_info), key);
+		}
+	}
+}
+
+/* Frees a conversion that is still being compiled, unless it was handed out. */
+static void
+_free_unfinished_args_conversion (pTHX_ void *data)
+{
+	struct _GPerlI11nArgsConversion **conversion = data;
+	PERL_UNUSED_CONTEXT;
+	if (*conversion)
+		args_conversion_free (*conversion);
+}
+
+static struct _GPerlI11nArgsConversion *
+args_conversion_new (GISignalInfo *signal_info, AV *spec)
+{
+	struct _GPerlI11nArgsConversion *conversion, *result;
+	guint i;
+
+	conversion = g_new0 (struct _GPerlI11nArgsConversion, 1);
+	conversion->n_slots = av_len (spec) + 1;
+	conversion->slots = g_new0 (GPerlI11nConversionSlot,
+	                            conversion->n_slots);
+
+	/* An invalid entry croaks, and then the slots compiled so far have to
+	 * go again. */
+	ENTER;
+	SAVEDESTRUCTOR_X (_free_unfinished_args_conversion, &conversion);
+	for (i = 0; i < conversion->n_slots; i++) {
+		SV **svp = av_fetch (spec, i, 0);
+		_compile_conversion_slot (signal_info,
+		                          svp ? *svp : &PL_sv_undef,
+		                          &conversion->slots[i]);
+	}
+	result = conversion;
+	conversion = NULL;
+	LEAVE;
+
+	return result;
+}
+
+static SV *
+_convert_to_package_type (SV *sv, GType gtype)
+{
+	return sv_2mortal (G_TYPE_IS_ENUM (gtype)
+		? gperl_convert_back_enum_pass_unknown (gtype, SvIV (sv))
+		: gperl_convert_back_flags (gtype, SvIV (sv)));
+}
+
+/* values and pointers hold the SVs and the C pointers of the instance and the
+ * args; values must be mortal.  The converted values are stored as mortals
+ * in converted, which must have room for conversion->n_slots entries.  This
+ * may call Perl code, so it needs to be wrapped with PUTBACK/SPAGAIN by the
+ * caller. */
+static void
+apply_args_conversion (const struct _GPerlI11nArgsConversion *conversion,
+                       SV **values,
+                       gpointer *pointers,
+                       SV **converted)
+{
+	guint i;
+
+	for (i = 0; i < conversion->n_slots; i++) {
+		const GPerlI11nConversionSlot *slot = &conversion->slots[i];
+		SV *sv = values[slot->pos];
+		if (slot->field) {
+			gpointer mem = pointers[slot->pos];
+			sv = mem
+				? sv_2mortal (get_field (slot->field, mem,
+				                         GI_TRANSFER_NOTHING))
+				: NULL;
+		}
+		if (!sv)
+			sv = &PL_sv_undef;
+		else if (slot->package_type)
+			sv = _convert_to_package_type (sv, slot->package_type);
+		converted[i] = sv;
+	}
+}
@@ -0,0 +1,295 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+/* Dispatching of callbacks that C code invokes on threads other than the one
+ * running the Perl interpreter the callback belongs to.  Once enabled for an
+ * interpreter, such invocations are pushed onto a lock-free queue and run in
+ * batches from an idle source on the GMainContext that was the thread-default
+ * one when dispatching was enabled.  Dispatching is enabled while it is
+ * requested explicitly or while asynchronous C calls are outstanding.
+ * Invocations that need to hand values back to the caller block the calling
+ * thread until they have run; the others get copies of their args and return
+ * right away.  Their callback info is pinned until they have run, so that it
+ * is not released or reused in the meantime. */
+
+/* Copied arg values are kept in slots of this alignment. */
+#define FOREIGN_ARG_SLOT(size) (((size) + 15) & ~((gsize) 15))
+
+typedef struct _GPerlI11nForeignCall GPerlI11nForeignCall;
+
+struct _GPerlI11nForeignCall {
+	GPerlI11nForeignCall *next;
+
+	struct _GPerlI11nCallbackDispatcher *dispatcher;
+	GPerlI11nPerlCallbackInfo *info;
+	gpointer resp;
+	gpointer *args;
+
+	/* whether the calling thread waits for the call to complete; if not,
+	 * args points to copies owned by the call. */
+	gboolean wait;
+	gboolean done;
+	GMutex mutex;
+	GCond cond;
+};
+
+typedef struct _GPerlI11nCallbackDispatcher {
+	gboolean enabled;
+	gboolean requested;
+	guint n_holds;
+	GThread *thread;
+	GMainContext *context;
+
+	/* the queue is a stack that producers push onto atomically; the
+	 * consumer takes it as a whole and reverses it. */
+	GPerlI11nForeignCall *queue;
+	gint drain_scheduled;
+
+	/* taken calls that have not been run yet; only accessed by the
+	 * interpreter's thread */
+	GSList *pending;
+} GPerlI11nCallbackDispatcher;
+
+G_LOCK_DEFINE_STATIC (dispatchers);
+
+/* perl context => GPerlI11nCallbackDispatcher; never freed */
+static GHashTable *dispatchers = NULL;
+static gint n_enabled_dispatchers = 0;
+
+static gboolean _drain_foreign_calls (gpointer data);
+
+static GPerlI11nCallbackDispatcher *
+_get_dispatcher (gpointer perl_context)
+{
+	GPerlI11nCallbackDispatcher *dispatcher = NULL;
+	G_LOCK (dispatchers);
+	if (dispatchers)
+		dispatcher = g_hash_table_lookup (dispatchers, perl_context);
+	G_UNLOCK (dispatchers);
+	return dispatcher;
+}
+
+/* Must be called with the dispatchers lock held. */
+static GPerlI11nCallbackDispatcher *
+_ensure_dispatcher (gpointer perl_context)
+{
+	GPerlI11nCallbackDispatcher *dispatcher;
+	if (!dispatchers)
+		dispatchers = g_hash_table_new (g_direct_hash, g_direct_equal);
+	dispatcher = g_hash_table_lookup (dispatchers, perl_context);
+	if (!dispatcher) {
+		dispatcher = g_new0 (GPerlI11nCallbackDispatcher, 1);
+		g_hash_table_insert (dispatchers, perl_context, dispatcher);
+	}
+	return dispatcher;
+}
+
+/* Must be called with the dispatchers lock held. */
+static void
+_update_dispatcher (GPerlI11nCallbackDispatcher *dispatcher)
+{
+	gboolean enable = dispatcher->requested || dispatcher->n_holds > 0;
+	if (enable && !dispatcher->enabled) {
+		if (dispatcher->context)
+			g_main_context_unref (dispatcher->context);
+		dispatcher->thread = g_thread_self ();
+		dispatcher->context = g_main_context_ref_thread_default ();
+		g_atomic_int_inc (&n_enabled_dispatchers);
+	} else if (!enable && dispatcher->enabled) {
+		g_atomic_int_add (&n_enabled_dispatchers, -1);
+	}
+	dispatcher->enabled = enable;
+}
+
+static void
+enable_foreign_thread_dispatch (gpointer perl_context, gboolean enable)
+{
+	GPerlI11nCallbackDispatcher *dispatcher;
+
+	G_LOCK (dispatchers);
+	dispatcher = _ensure_dispatcher (perl_context);
+	dispatcher->requested = enable;
+	if (!enable)
+		dispatcher->n_holds = 0;
+	_update_dispatcher (dispatcher);
+	G_UNLOCK (dispatchers);
+}
+
+/* Keeps dispatching enabled for the duration of an asynchronous C call.
+ * Every hold must be matched by a release on the interpreter's thread. */
+static void
+hold_foreign_thread_dispatch (gpointer perl_context, gboolean hold)
+{
+	GPerlI11nCallbackDispatcher *dispatcher;
+
+	G_LOCK (dispatchers);
+	dispatcher = _ensure_dispatcher (perl_context);
+	if (hold)
+		dispatcher->n_holds++;
+	else if (dispatcher->n_holds > 0)
+		dispatcher->n_holds--;
+	_update_dispatcher (dispatcher);
+	G_UNLOCK (dispatchers);
+}
+
+static void
+_schedule_drain (GPerlI11nCallbackDispatcher *dispatcher)
+{
+	if (g_atomic_int_compare_and_exchange (&dispatcher->drain_scheduled,
+	                                       0, 1))
+	{
+		GSource *source = g_idle_source_new ();
+		g_source_set_callback (source, _drain_foreign_calls,
+		                       dispatcher, NULL);
+		g_source_attach (source, dispatcher->context);
+		g_source_unref (source);
+	}
+}
+
+static void
+_push_foreign_call (GPerlI11nCallbackDispatcher *dispatcher,
+                    GPerlI11nForeignCall *call)
+{
+	GPerlI11nForeignCall *head;
+
+	do {
+		head = g_atomic_pointer_get (&dispatcher->queue);
+		call->next = head;
+	} while (!g_atomic_pointer_compare_and_exchange (&dispatcher->queue,
+	                                                 head, call));
+
+	_schedule_drain (dispatcher);
+}
+
+/* Copies the values that args point to into one block owned by the call. */
+static gpointer *
+_copy_foreign_args (ffi_cif *cif, gpointer *args)
+{
+	gpointer *copies;
+	gchar *values;
+	gsize size = 0;
+	guint i;
+
+	for (i = 0; i < cif->nargs; i++)
+		size += FOREIGN_ARG_SLOT (cif->arg_types[i]->size);
+	copies = g_malloc (sizeof (gpointer) * cif->nargs + size);
+	values = (gchar *) (copies + cif->nargs);
+	for (i = 0; i < cif->nargs; i++) {
+		memcpy (values, args[i], cif->arg_types[i]->size);
+		copies[i] = values;
+		values += FOREIGN_ARG_SLOT (cif->arg_types[i]->size);
+	}
+	return copies;
+}
+
+/* Called on entry of every Perl callback.  Returns FALSE if the callback is
+ * to run right away on the current thread. */
+static gboolean
+dispatch_foreign_perl_callback (GPerlI11nPerlCallbackInfo *info,
+                                const GPerlI11nPerlPlan *plan,
+                                ffi_cif *cif,
+                                gpointer resp,
+                                gpointer *args)
+{
+	GPerlI11nCallbackDispatcher *dispatcher;
+	GPerlI11nForeignCall *call;
+
+	if (!g_atomic_int_get (&n_enabled_dispatchers))
+		return FALSE;
+	dispatcher = _get_dispatcher (info->priv);
+	if (!dispatcher || !dispatcher->enabled ||
+	    dispatcher->thread == g_thread_self ())
+		return FALSE;
+
+	dwarn ("dispatching callback %p from thread %p\n",
+	       info, g_thread_self ());
+
+	call = g_new0 (GPerlI11nForeignCall, 1);
+	call->dispatcher = dispatcher;
+	call->info = info;
+	call->wait = !plan->can_run_detached;
+	if (call->wait) {
+		call->resp = resp;
+		call->args = args;
+		g_mutex_init (&call->mutex);
+		g_cond_init (&call->cond);
+	} else {
+		call->args = _copy_foreign_args (cif, args);
+		pin_perl_callback (info);
+	}
+
+	if (!call->wait) {
+		_push_foreign_call (dispatcher, call);
+		return TRUE;
+	}
+
+	g_mutex_lock (&call->mutex);
+	_push_foreign_call (dispatcher, call);
+	while (!call->done)
+		g_cond_wait (&call->cond, &call->mutex);
+	g_mutex_unlock (&call->mutex);
+
+	g_mutex_clear (&call->mutex);
+	g_cond_clear (&call->cond);
+	g_free (call);
+	return TRUE;
+}
+
+/* Runs as a destructor so that the caller is woken up even if the callback
+ * croaks.  In that case, the rest of the batch is left to another drain. */
+static void
+_complete_foreign_call (pTHX_ void *data)
+{
+	GPerlI11nForeignCall *call = data;
+	PERL_UNUSED_CONTEXT;
+	if (call->dispatcher->pending)
+		_schedule_drain (call->dispatcher);
+	if (call->wait) {
+		g_mutex_lock (&call->mutex);
+		call->done = TRUE;
+		g_cond_signal (&call->cond);
+		g_mutex_unlock (&call->mutex);
+	} else {
+		unpin_perl_callback (call->info);
+		g_free (call->args);
+		g_free (call);
+	}
+}
+
+static gboolean
+_drain_foreign_calls (gpointer data)
+{
+	GPerlI11nCallbackDispatcher *dispatcher = data;
+	GPerlI11nForeignCall *head, *call;
+	GSList *taken = NULL;
+	ffi_sarg dummy_resp;
+
+	/* Reset the flag before taking the queue so that calls pushed from
+	 * now on schedule another drain. */
+	g_atomic_int_set (&dispatcher->drain_scheduled, 0);
+	do {
+		head = g_atomic_pointer_get (&dispatcher->queue);
+	} while (!g_atomic_pointer_compare_and_exchange (&dispatcher->queue,
+	                                                 head, NULL));
+	/* prepending reverses the stack into arrival order */
+	for (call = head; call != NULL; call = call->next)
+		taken = g_slist_prepend (taken, call);
+	dispatcher->pending = g_slist_concat (dispatcher->pending, taken);
+
+	while (dispatcher->pending) {
+		call = dispatcher->pending->data;
+		dispatcher->pending =
+			g_slist_delete_link (dispatcher->pending,
+			                     dispatcher->pending);
+		{
+			dTHXa (call->info->priv);
+			ENTER;
+			SAVEDESTRUCTOR_X (_complete_foreign_call, call);
+			invoke_perl_code (NULL,
+			                  call->wait ? call->resp : &dummy_resp,
+			                  call->args, call->info);
+			LEAVE;
+		}
+	}
+
+	return G_SOURCE_REMOVE;
+}
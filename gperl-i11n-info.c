@@ -1,42 +1,5 @@
 /* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
 
-static GIFunctionInfo *
-_find_struct_method (GIStructInfo *info, const gchar *method)
-{
-	/* g_struct_info_find_method is broken for class structs like
-	 * GtkWidgetClass, so we search manually.  See
-	 * <https://bugzilla.gnome.org/show_bug.cgi?id=700338>. */
-	gint n_methods;
-	gint i;
-	n_methods = g_struct_info_get_n_methods (info);
-	for (i = 0; i < n_methods; i++) {
-		GIFunctionInfo *method_info =
-			g_struct_info_get_method (info, i);
-		if (strEQ (g_base_info_get_name (method_info), method))
-			return method_info;
-		g_base_info_unref (method_info);
-	}
-	return NULL;
-}
-
-static GIFunctionInfo *
-_find_enum_method (GIEnumInfo *info, const gchar *method)
-{
-#if GI_CHECK_VERSION (1, 29, 17)
-	gint n_methods;
-	gint i;
-	n_methods = g_enum_info_get_n_methods (info);
-	for (i = 0; i < n_methods; i++) {
-		GIFunctionInfo *method_info =
-			g_enum_info_get_method (info, i);
-		if (strEQ (g_base_info_get_name (method_info), method))
-			return method_info;
-		g_base_info_unref (method_info);
-	}
-#endif
-	return NULL;
-}
-
 /* Caller owns return value */
 static GIFunctionInfo *
 get_function_info (GIRepository *repository,
@@ -56,31 +19,19 @@ get_function_info (GIRepository *repository,
 
 		switch (g_base_info_get_type (namespace_info)) {
 		    case GI_INFO_TYPE_OBJECT:
-			function_info = g_object_info_find_method (
-				(GIObjectInfo *) namespace_info,
-				method);
-			break;
 		    case GI_INFO_TYPE_INTERFACE:
-			function_info = g_interface_info_find_method (
-				(GIInterfaceInfo *) namespace_info,
-				method);
-			break;
 		    case GI_INFO_TYPE_BOXED:
 		    case GI_INFO_TYPE_STRUCT:
-			function_info = _find_struct_method (
-				(GIStructInfo *) namespace_info,
-				method);
-			break;
-                    case GI_INFO_TYPE_UNION:
-			function_info = g_union_info_find_method (
-				(GIUnionInfo *) namespace_info,
-				method);
-			break;
+		    case GI_INFO_TYPE_UNION:
 		    case GI_INFO_TYPE_ENUM:
 		    case GI_INFO_TYPE_FLAGS:
-			function_info = _find_enum_method (
-				(GIEnumInfo *) namespace_info,
-				method);
+			/* We use our own index instead of g_*_info_find_method.
+			 * Besides being faster for repeated lookups, this also
+			 * avoids g_struct_info_find_method which is broken for
+			 * class structs like GtkWidgetClass.  See
+			 * <https://bugzilla.gnome.org/show_bug.cgi?id=700338>. */
+			function_info = (GIFunctionInfo *) find_member (
+				namespace_info, GPERL_I11N_MEMBER_METHOD, method);
 			break;
 		    default:
 			ccroak ("Base info for namespace %s has incorrect type",
@@ -117,38 +68,11 @@ get_function_info (GIRepository *repository,
 static GIFieldInfo *
 get_field_info (GIBaseInfo *info, const gchar *field_name)
 {
-	GIInfoType info_type;
-	info_type = g_base_info_get_type (info);
-	switch (info_type) {
+	switch (g_base_info_get_type (info)) {
 	    case GI_INFO_TYPE_BOXED:
 	    case GI_INFO_TYPE_STRUCT:
-	    {
-		gint n_fields, i;
-		n_fields = g_struct_info_get_n_fields ((GIStructInfo *) info);
-		for (i = 0; i < n_fields; i++) {
-			GIFieldInfo *field_info;
-			field_info = g_struct_info_get_field ((GIStructInfo *) info, i);
-			if (0 == strcmp (field_name, g_base_info_get_name (field_info))) {
-				return field_info;
-			}
-			g_base_info_unref (field_info);
-		}
-		break;
-	    }
 	    case GI_INFO_TYPE_UNION:
-	    {
-		gint n_fields, i;
-		n_fields = g_union_info_get_n_fields ((GIStructInfo *) info);
-		for (i = 0; i < n_fields; i++) {
-			GIFieldInfo *field_info;
-			field_info = g_union_info_get_field ((GIStructInfo *) info, i);
-			if (0 == strcmp (field_name, g_base_info_get_name (field_info))) {
-				return field_info;
-			}
-			g_base_info_unref (field_info);
-		}
-		break;
-	    }
+		return find_member (info, GPERL_I11N_MEMBER_FIELD, field_name);
 	    default:
 		break;
 	}
@@ -159,26 +83,11 @@ get_field_info (GIBaseInfo *info, const gchar *field_name)
 static GISignalInfo *
 get_signal_info (GIBaseInfo *container_info, const gchar *signal_name)
 {
-	if (GI_IS_OBJECT_INFO (container_info)) {
-		return g_object_info_find_signal (container_info, signal_name);
-	} else if (GI_IS_INTERFACE_INFO (container_info)) {
-#if GI_CHECK_VERSION (1, 35, 4)
-		return g_interface_info_find_signal (container_info, signal_name);
-#else
-{
-		gint n_signals;
-		gint i;
-		n_signals = g_interface_info_get_n_signals (container_info);
-		for (i = 0; i < n_signals; i++) {
-			GISignalInfo *siginfo =
-				g_interface_info_get_signal (container_info, i);
-			if (strEQ (g_base_info_get_name (siginfo), signal_name))
-				return siginfo;
-			g_base_info_unref (siginfo);
-		}
-		return NULL;
-}
-#endif
+	if (GI_IS_OBJECT_INFO (container_info) ||
+	    GI_IS_INTERFACE_INFO (container_info))
+	{
+		return find_member (container_info, GPERL_I11N_MEMBER_SIGNAL,
+		                    signal_name);
 	}
 	return NULL;
 }
@@ -214,7 +123,10 @@ synthesize_prefixed_gtype_name (GIBaseInfo *info)
 static GType
 get_gtype (GIRegisteredTypeInfo *info)
 {
-	GType gtype = g_registered_type_info_get_g_type (info);
+	GType gtype = _lookup_cached_gtype (info);
+	if (gtype)
+		return gtype;
+	gtype = g_registered_type_info_get_g_type (info);
 	/* Fall back to the registered type name, and if that doesn't work
 	 * either, construct the full name and the prefixed full name and try
 	 * them. */
@@ -234,17 +146,19 @@ get_gtype (GIRegisteredTypeInfo *info)
 		gtype = g_type_from_name (full_name);
 		g_free (full_name);
 	}
-	return gtype ? gtype : G_TYPE_NONE;
+	if (!gtype)
+		return G_TYPE_NONE;
+	_store_cached_gtype (info, gtype);
+	return gtype;
 }
 
 static const gchar *
 get_package_for_basename (const gchar *basename)
 {
 	SV **svp;
-	HV *basename_to_package =
-		get_hv ("Glib::Object::Introspection::_BASENAME_TO_PACKAGE", 0);
-	g_assert (basename_to_package);
-	svp = hv_fetch (basename_to_package, basename, strlen (basename), 0);
+	dMY_CXT;
+	svp = hv_fetch (MY_CXT.basename_to_package,
+	                basename, strlen (basename), 0);
 	if (!svp || !gperl_sv_is_defined (*svp))
 	    return NULL;
 	return SvPV_nolen (*svp);
@@ -253,8 +167,33 @@ get_package_for_basename (const gchar *basename)
 static gboolean
 is_forbidden_sub_name (const gchar *name)
 {
-	HV *forbidden_sub_names =
-		get_hv ("Glib::Object::Introspection::_FORBIDDEN_SUB_NAMES", 0);
-	g_assert (forbidden_sub_names);
-	return hv_exists (forbidden_sub_names, name, strlen (name));
+	dMY_CXT;
+	return hv_exists (MY_CXT.forbidden_sub_names, name, strlen (name));
+}
+
+/* Asks the Perl code ref filter whether the type called name should be set up.
+ * The caller must have called PUTBACK. */
+static gboolean
+is_type_selected (SV *filter, const gchar *name)
+{
+	gboolean selected;
+	dSP;
+
+	ENTER;
+	SAVETMPS;
+
+	PUSHMARK (SP);
+	XPUSHs (sv_2mortal (newSVpv (name, 0)));
+	PUTBACK;
+
+	call_sv (filter, G_SCALAR);
+
+	SPAGAIN;
+	selected = SvTRUE (POPs);
+	PUTBACK;
+
+	FREETMPS;
+	LEAVE;
+
+	return selected;
 }
@@ -1,7 +1,7 @@
 /* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
 
 static void _prepare_c_invocation_info (GPerlI11nCInvocationInfo *iinfo,
-                                        GICallableInfo *info,
+                                        const GPerlI11nCPlan *plan,
                                         IV items,
                                         UV internal_stack_offset,
                                         const gchar *package,
@@ -15,9 +15,16 @@ static void _handle_automatic_arg (guint pos,
                                    GIArgument * arg,
                                    GPerlI11nCInvocationInfo * invocation_info);
 static gpointer _allocate_out_mem (GITypeInfo *arg_type);
+static void _marshal_c_args (GPerlI11nCInvocationInfo *iinfo,
+                             I32 ax, I32 items,
+                             gpointer *instance,
+                             gpointer local_error_address_p);
+static SV ** _push_c_results (GPerlI11nCInvocationInfo *iinfo,
+                              gpointer return_value_p,
+                              SV **sp);
 
 static void
-invoke_c_code (GICallableInfo *info,
+invoke_c_code (const GPerlI11nCPlan *plan,
                gpointer func_pointer,
                SV **sp, I32 ax, SV **mark, I32 items, /* these correspond to dXSARGS */
                UV internal_stack_offset,
@@ -25,37 +32,79 @@ invoke_c_code (GICallableInfo *info,
                const gchar *namespace,
                const gchar *function)
 {
-	ffi_cif cif;
 	gpointer instance = NULL;
-	guint i;
 	GPerlI11nCInvocationInfo iinfo;
-	guint n_return_values;
 #if GI_CHECK_VERSION (1, 32, 0)
 	GIFFIReturnValue ffi_return_value;
+#else
+	GIArgument ffi_return_value;
 #endif
-	gpointer return_value_p;
-	GIArgument return_value;
 	GError * local_error = NULL;
 	gpointer local_error_address = &local_error;
 
 	PERL_UNUSED_VAR (mark);
 
-	_prepare_c_invocation_info (&iinfo, info, items, internal_stack_offset,
+	_prepare_c_invocation_info (&iinfo, plan, items, internal_stack_offset,
 	                            package, namespace, function);
 
 	_check_n_args (&iinfo);
 
-	if (iinfo.is_method) {
-		instance = instance_sv_to_pointer (info, ST (0 + iinfo.stack_offset), &iinfo.base);
-		iinfo.arg_types_ffi[0] = &ffi_type_pointer;
-		iinfo.args[0] = &instance;
+	_marshal_c_args (&iinfo, ax, items, &instance, &local_error_address);
+
+	/*
+	 * --- call -----------------------------------------------------------
+	 */
+
+	/* the call interface has already been prepared by c_plan_new */
+	if (!plan->cif_is_prepared) {
+		_clear_c_invocation_info (&iinfo);
+		ccroak ("Could not prepare a call interface");
+	}
+
+	/* Wrap the call in PUTBACK/SPAGAIN because the C function might end up
+	 * calling Perl code (via a vfunc), which might reallocate the stack
+	 * and hence invalidate 'sp'. */
+	PUTBACK;
+	ffi_call ((ffi_cif *) &plan->cif, func_pointer, &ffi_return_value, iinfo.args);
+	SPAGAIN;
+
+	/* free call-scoped data */
+	invoke_free_after_call_handlers (&iinfo.base);
+
+	if (local_error) {
+		_clear_c_invocation_info (&iinfo);
+		gperl_croak_gerror (NULL, local_error);
+	}
+
+	sp = _push_c_results (&iinfo, &ffi_return_value, sp);
+
+	_clear_c_invocation_info (&iinfo);
+
+	PUTBACK;
+}
+
+/* Converts the Perl args on the stack into the ffi args in iinfo.  The
+ * invocant, if any, is stored in *instance. */
+static void
+_marshal_c_args (GPerlI11nCInvocationInfo *iinfo,
+                 I32 ax, I32 items,
+                 gpointer *instance,
+                 gpointer local_error_address_p)
+{
+	guint i;
+
+	if (iinfo->is_method) {
+		*instance = instance_sv_to_pointer (iinfo->plan->base.interface,
+		                                    ST (0 + iinfo->stack_offset),
+		                                    &iinfo->base);
+		iinfo->args[0] = instance;
 	}
 
 	/*
 	 * --- handle arguments -----------------------------------------------
 	 */
 
-	for (i = 0 ; i < iinfo.base.n_args ; i++) {
+	for (i = 0 ; i < iinfo->base.n_args ; i++) {
 		GIArgInfo * arg_info;
 		GITypeInfo * arg_type;
 		GITransfer transfer;
@@ -63,20 +112,20 @@ invoke_c_code (GICallableInfo *info,
 		gint perl_stack_pos, ffi_stack_pos;
 		SV *current_sv;
 
-		arg_info = &(iinfo.base.arg_infos[i]);
-		arg_type = &(iinfo.base.arg_types[i]);
+		arg_info = &(iinfo->base.arg_infos[i]);
+		arg_type = &(iinfo->base.arg_types[i]);
 		transfer = g_arg_info_get_ownership_transfer (arg_info);
 		may_be_null = g_arg_info_may_be_null (arg_info);
 #if GI_CHECK_VERSION (1, 29, 0)
 		is_skipped = g_arg_info_is_skip (arg_info);
 #endif
 		perl_stack_pos = (gint) i
-		               + (gint) iinfo.constructor_offset
-		               + (gint) iinfo.method_offset
-		               + (gint) iinfo.stack_offset
-		               + iinfo.dynamic_stack_offset;
+		               + (gint) iinfo->constructor_offset
+		               + (gint) iinfo->method_offset
+		               + (gint) iinfo->stack_offset
+		               + iinfo->dynamic_stack_offset;
 		ffi_stack_pos = (gint) i
-		              + (gint) iinfo.method_offset;
+		              + (gint) iinfo->method_offset;
 		g_assert (perl_stack_pos >= 0 && ffi_stack_pos >= 0);
 
 		/* FIXME: Is this right?  I'm confused about the relation of
@@ -84,87 +133,84 @@ invoke_c_code (GICallableInfo *info,
 		 * g_arg_info_get_closure and g_arg_info_get_destroy.  We used
 		 * to add method_offset, but that stopped being correct at some
 		 * point. */
-		iinfo.base.current_pos = i; /* + method_offset; */
+		iinfo->base.current_pos = i; /* + method_offset; */
 
 		dwarn ("arg %d: tag = %d (%s), is_pointer = %d, is_automatic = %d\n",
 		       i,
 		       g_type_info_get_tag (arg_type),
 		       g_type_tag_to_string (g_type_info_get_tag (arg_type)),
 		       g_type_info_is_pointer (arg_type),
-		       iinfo.is_automatic_arg[i]);
+		       iinfo->is_automatic_arg[i]);
 
 		/* Use undef for missing args (due to the checks above, these
 		 * must be nullable). */
 		current_sv = perl_stack_pos < items ? ST (perl_stack_pos) : &PL_sv_undef;
+		iinfo->base.current_arg_is_omitted = perl_stack_pos >= items;
 
 		switch (g_arg_info_get_direction (arg_info)) {
 		    case GI_DIRECTION_IN:
-			if (iinfo.is_automatic_arg[i]) {
-				iinfo.dynamic_stack_offset--;
+			if (iinfo->is_automatic_arg[i]) {
+				iinfo->dynamic_stack_offset--;
 			} else if (is_skipped) {
-				iinfo.dynamic_stack_offset--;
+				iinfo->dynamic_stack_offset--;
 			} else {
 				sv_to_arg (current_sv,
-				           &iinfo.in_args[i], arg_info, arg_type,
-				           transfer, may_be_null, &iinfo.base);
+				           &iinfo->in_args[i], arg_info, arg_type,
+				           transfer, may_be_null, &iinfo->base);
 			}
-			iinfo.arg_types_ffi[ffi_stack_pos] =
-				g_type_info_get_ffi_type (arg_type);
-			iinfo.args[ffi_stack_pos] = &iinfo.in_args[i];
+			iinfo->args[ffi_stack_pos] = &iinfo->in_args[i];
 			break;
 
 		    case GI_DIRECTION_OUT:
 			if (g_arg_info_is_caller_allocates (arg_info)) {
-				iinfo.base.aux_args[i].v_pointer =
+				iinfo->base.aux_args[i].v_pointer =
 					_allocate_out_mem (arg_type);
-				iinfo.out_args[i].v_pointer = &iinfo.base.aux_args[i];
-				iinfo.args[ffi_stack_pos] = &iinfo.base.aux_args[i];
+				iinfo->out_args[i].v_pointer = &iinfo->base.aux_args[i];
+				iinfo->args[ffi_stack_pos] = &iinfo->base.aux_args[i];
 			} else {
-				iinfo.out_args[i].v_pointer = &iinfo.base.aux_args[i];
-				iinfo.args[ffi_stack_pos] = &iinfo.out_args[i];
+				iinfo->out_args[i].v_pointer = &iinfo->base.aux_args[i];
+				iinfo->args[ffi_stack_pos] = &iinfo->out_args[i];
 			}
-			iinfo.arg_types_ffi[ffi_stack_pos] = &ffi_type_pointer;
 			/* Adjust the dynamic stack offset so that this out
 			 * argument doesn't inadvertedly eat up an in argument. */
-			iinfo.dynamic_stack_offset--;
+			iinfo->dynamic_stack_offset--;
 			break;
 
 		    case GI_DIRECTION_INOUT:
-			iinfo.in_args[i].v_pointer =
-				iinfo.out_args[i].v_pointer =
-					&iinfo.base.aux_args[i];
-			if (iinfo.is_automatic_arg[i]) {
-				iinfo.dynamic_stack_offset--;
+			iinfo->in_args[i].v_pointer =
+				iinfo->out_args[i].v_pointer =
+					&iinfo->base.aux_args[i];
+			if (iinfo->is_automatic_arg[i]) {
+				iinfo->dynamic_stack_offset--;
 			} else if (is_skipped) {
-				iinfo.dynamic_stack_offset--;
+				iinfo->dynamic_stack_offset--;
 			} else {
-				/* We pass iinfo.in_args[i].v_pointer here,
-				 * not &iinfo.in_args[i], so that the value
+				/* We pass iinfo->in_args[i].v_pointer here,
+				 * not &iinfo->in_args[i], so that the value
 				 * pointed to is filled from the SV. */
 				sv_to_arg (current_sv,
-				           iinfo.in_args[i].v_pointer, arg_info, arg_type,
-				           transfer, may_be_null, &iinfo.base);
+				           iinfo->in_args[i].v_pointer, arg_info, arg_type,
+				           transfer, may_be_null, &iinfo->base);
 			}
-			iinfo.arg_types_ffi[ffi_stack_pos] = &ffi_type_pointer;
-			iinfo.args[ffi_stack_pos] = &iinfo.in_args[i];
+			iinfo->args[ffi_stack_pos] = &iinfo->in_args[i];
 			break;
 		}
 	}
 
 	/* do another pass to handle automatic args */
-	for (i = 0 ; i < iinfo.base.n_args ; i++) {
+	for (i = 0 ; i < iinfo->base.n_args ; i++) {
 		GIArgInfo * arg_info;
 		GITypeInfo * arg_type;
-		if (!iinfo.is_automatic_arg[i])
+		if (!iinfo->is_automatic_arg[i])
 			continue;
-		arg_info = &(iinfo.base.arg_infos[i]);
-		arg_type = &(iinfo.base.arg_types[i]);
+		arg_info = &(iinfo->base.arg_infos[i]);
+		arg_type = &(iinfo->base.arg_types[i]);
 		switch (g_arg_info_get_direction (arg_info)) {
 		    case GI_DIRECTION_IN:
-			_handle_automatic_arg (i, arg_info, arg_type, &iinfo.in_args[i], &iinfo);
+			_handle_automatic_arg (i, arg_info, arg_type, &iinfo->in_args[i], iinfo);
 			break;
 		    case GI_DIRECTION_INOUT:
-			_handle_automatic_arg (i, arg_info, arg_type, &iinfo.base.aux_args[i], &iinfo);
+			_handle_automatic_arg (i, arg_info, arg_type, &iinfo->base.aux_args[i], iinfo);
 			break;
 		    case GI_DIRECTION_OUT:
 			/* handled later */
@@ -172,43 +218,22 @@ invoke_c_code (GICallableInfo *info,
 		}
 	}
 
-	if (iinfo.throws) {
-		iinfo.args[iinfo.n_invoke_args - 1] = &local_error_address;
-		iinfo.arg_types_ffi[iinfo.n_invoke_args - 1] = &ffi_type_pointer;
-	}
-
-	/*
-	 * --- prepare & call -------------------------------------------------
-	 */
-
-	/* prepare and call the function */
-	if (FFI_OK != ffi_prep_cif (&cif, FFI_DEFAULT_ABI, iinfo.n_invoke_args,
-	                            iinfo.base.return_type_ffi, iinfo.arg_types_ffi))
-	{
-		_clear_c_invocation_info (&iinfo);
-		ccroak ("Could not prepare a call interface");
+	if (iinfo->throws) {
+		iinfo->args[iinfo->n_invoke_args - 1] = local_error_address_p;
 	}
+}
 
-#if GI_CHECK_VERSION (1, 32, 0)
-	return_value_p = &ffi_return_value;
-#else
-	return_value_p = &return_value;
-#endif
-
-	/* Wrap the call in PUTBACK/SPAGAIN because the C function might end up
-	 * calling Perl code (via a vfunc), which might reallocate the stack
-	 * and hence invalidate 'sp'. */
-	PUTBACK;
-	ffi_call (&cif, func_pointer, return_value_p, iinfo.args);
-	SPAGAIN;
-
-	/* free call-scoped data */
-	invoke_free_after_call_handlers (&iinfo.base);
-
-	if (local_error) {
-		_clear_c_invocation_info (&iinfo);
-		gperl_croak_gerror (NULL, local_error);
-	}
+/* Pushes the return value and the out args onto the stack and returns the new
+ * stack pointer.  return_value_p points to the storage ffi_call wrote the
+ * return value to. */
+static SV **
+_push_c_results (GPerlI11nCInvocationInfo *iinfo,
+                 gpointer return_value_p,
+                 SV **sp)
+{
+	GIArgument return_value;
+	guint n_return_values;
+	guint i;
 
 	/*
 	 * --- handle return values -------------------------------------------
@@ -217,27 +242,29 @@ invoke_c_code (GICallableInfo *info,
 #if GI_CHECK_VERSION (1, 32, 0)
 	/* libffi has special semantics for return value storage; see `man
 	 * ffi_call`.  We use gobject-introspection's extraction helper. */
-	gi_type_info_extract_ffi_return_value (&iinfo.base.return_type_info,
-	                                       &ffi_return_value,
+	gi_type_info_extract_ffi_return_value (&iinfo->base.return_type_info,
+	                                       return_value_p,
 	                                       &return_value);
+#else
+	return_value = * (GIArgument *) return_value_p;
 #endif
 
 	n_return_values = 0;
 
 	/* place return value and output args on the stack */
-	if (iinfo.base.has_return_value
+	if (iinfo->base.has_return_value
 #if GI_CHECK_VERSION (1, 29, 0)
-	    && !g_callable_info_skip_return ((GICallableInfo *) info)
+	    && !g_callable_info_skip_return (iinfo->plan->base.interface)
 #endif
 	   )
 	{
 		SV *value;
-		dwarn ("return value: type = %p\n", &iinfo.base.return_type_info);
+		dwarn ("return value: type = %p\n", &iinfo->base.return_type_info);
 		value = SAVED_STACK_SV (arg_to_sv (&return_value,
-		                                   &iinfo.base.return_type_info,
-		                                   iinfo.base.return_type_transfer,
+		                                   &iinfo->base.return_type_info,
+		                                   iinfo->base.return_type_transfer,
 		                                   GPERL_I11N_MEMORY_SCOPE_IRRELEVANT,
-		                                   &iinfo.base));
+		                                   &iinfo->base));
 		if (value) {
 			XPUSHs (sv_2mortal (value));
 			n_return_values++;
@@ -245,11 +272,11 @@ invoke_c_code (GICallableInfo *info,
 	}
 
 	/* out args */
-	for (i = 0 ; i < iinfo.base.n_args ; i++) {
+	for (i = 0 ; i < iinfo->base.n_args ; i++) {
 		GIArgInfo * arg_info;
-		if (iinfo.is_automatic_arg[i])
+		if (iinfo->is_automatic_arg[i])
 			continue;
-		arg_info = &(iinfo.base.arg_infos[i]);
+		arg_info = &(iinfo->base.arg_infos[i]);
 #if GI_CHECK_VERSION (1, 29, 0)
 		if (g_arg_info_is_skip (arg_info)) {
 			continue;
@@ -266,11 +293,11 @@ invoke_c_code (GICallableInfo *info,
 			transfer = g_arg_info_is_caller_allocates (arg_info)
 			         ? GI_TRANSFER_CONTAINER
 			         : g_arg_info_get_ownership_transfer (arg_info);
-			sv = SAVED_STACK_SV (arg_to_sv (iinfo.out_args[i].v_pointer,
-			                                &(iinfo.base.arg_types[i]),
+			sv = SAVED_STACK_SV (arg_to_sv (iinfo->out_args[i].v_pointer,
+			                                &(iinfo->base.arg_types[i]),
 			                                transfer,
 			                                GPERL_I11N_MEMORY_SCOPE_IRRELEVANT,
-			                                &iinfo.base));
+			                                &iinfo->base));
 			if (sv) {
 				XPUSHs (sv_2mortal (sv));
 				n_return_values++;
@@ -283,114 +310,1013 @@ invoke_c_code (GICallableInfo *info,
 		}
 	}
 
-	_clear_c_invocation_info (&iinfo);
+	/* a future set up by a marshaller, handing over our reference */
+	if (iinfo->base.future) {
+		XPUSHs (sv_2mortal (iinfo->base.future));
+		iinfo->base.future = NULL;
+		n_return_values++;
+	}
 
 	dwarn ("n_return_values = %d\n", n_return_values);
 
+	return sp;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Asynchronous invocation: the args are marshalled on the calling thread, the
+ * C function is called on a thread of a shared pool, and the results are
+ * converted and handed to a future on the main context that was the
+ * thread-default one at call time.  Since no Perl code may run on the pool
+ * threads, functions taking callbacks are refused, and callbacks the C code
+ * reaches anyway (like Perl implementations of vfuncs) are dispatched to that
+ * main context while the call is outstanding, see gperl-i11n-dispatch.c. */
+
+#define FUTURE_PACKAGE "Glib::Object::Introspection::Future"
+
+typedef struct {
+	GPerlI11nCInvocationInfo iinfo;
+	gpointer func_pointer;
+	gpointer instance;
+	GError *local_error;
+	gpointer local_error_address;
+#if GI_CHECK_VERSION (1, 32, 0)
+	GIFFIReturnValue ffi_return_value;
+#else
+	GIArgument ffi_return_value;
+#endif
+
+	/* the arg copies and temporaries that the marshalled args may point
+	 * into */
+	AV *keep_alive;
+	SV *future;
+	gboolean is_started;
+	GMainContext *context;
+	gpointer priv;
+} GPerlI11nAsyncCCall;
+
+G_LOCK_DEFINE_STATIC (async_c_calls);
+static GThreadPool *async_c_call_pool = NULL;
+
+static void
+_free_async_c_call (GPerlI11nAsyncCCall *call)
+{
+	dTHXa (call->priv);
+	_clear_c_invocation_info (&call->iinfo);
+	SvREFCNT_dec (call->keep_alive);
+	SvREFCNT_dec (call->future);
+	if (call->context)
+		g_main_context_unref (call->context);
+	g_free (call);
+}
+
+/* Runs when the scope of the marshalling is left, so that a call whose
+ * marshalling croaked is freed. */
+static void
+_abandon_async_c_call (pTHX_ void *data)
+{
+	GPerlI11nAsyncCCall *call = data;
+	PERL_UNUSED_CONTEXT;
+	if (!call->is_started)
+		_free_async_c_call (call);
+}
+
+/* Returns a new, unresolved future. */
+static SV *
+new_future (void)
+{
+	return sv_bless (newRV_noinc ((SV *) newHV ()),
+	                 gv_stashpv (FUTURE_PACKAGE, TRUE));
+}
+
+static gboolean
+_complete_async_c_call (gpointer data)
+{
+	GPerlI11nAsyncCCall *call = data;
+	const char *method;
+	dTHXa (call->priv);
+	dSP;
+
+	ENTER;
+	SAVETMPS;
+
+	invoke_free_after_call_handlers (&call->iinfo.base);
+
+	PUSHMARK (SP);
+	XPUSHs (call->future);
+	if (call->local_error) {
+		XPUSHs (sv_2mortal (gperl_sv_from_gerror (call->local_error)));
+		g_error_free (call->local_error);
+		method = "_fail";
+	} else {
+		SP = _push_c_results (&call->iinfo, &call->ffi_return_value, SP);
+		method = "_resolve";
+	}
+	PUTBACK;
+	call_method (method, G_DISCARD | G_EVAL);
+	if (SvTRUE (ERRSV))
+		gperl_run_exception_handlers ();
+
+	FREETMPS;
+	LEAVE;
+
+	hold_foreign_thread_dispatch (call->priv, FALSE);
+	_free_async_c_call (call);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_run_async_c_call (gpointer data, gpointer user_data)
+{
+	GPerlI11nAsyncCCall *call = data;
+	GSource *source;
+	PERL_UNUSED_VAR (user_data);
+
+	ffi_call ((ffi_cif *) &call->iinfo.plan->cif, call->func_pointer,
+	          &call->ffi_return_value, call->iinfo.args);
+
+	source = g_idle_source_new ();
+	g_source_set_callback (source, _complete_async_c_call, call, NULL);
+	g_source_attach (source, call->context);
+	g_source_unref (source);
+}
+
+/* Calls the finish function of an async operation with the source object and
+ * the result, which is what a GAsyncReadyCallback does.  Pushes the results
+ * onto the stack and returns the new stack pointer, or sets *error.  The
+ * finish function must take nothing but these two args. */
+static SV **
+_call_finish_function (const GPerlI11nFunctionEntry *finish,
+                       GObject *source_object,
+                       GObject *res,
+                       GError **error,
+                       SV **sp)
+{
+	const GPerlI11nCPlan *plan = finish->plan;
+	GPerlI11nCInvocationInfo iinfo;
+	gpointer instance = NULL;
+#if GI_CHECK_VERSION (1, 32, 0)
+	GIFFIReturnValue ffi_return_value;
+#else
+	GIArgument ffi_return_value;
+#endif
+	GError *local_error = NULL;
+	gpointer local_error_address = &local_error;
+	I32 ax, items = 0;
+
+	/* Put the args onto the stack as if the finish function was called
+	 * from Perl. */
+	if (plan->is_method) {
+		XPUSHs (sv_2mortal (gperl_new_object (source_object, FALSE)));
+		items++;
+	}
+	XPUSHs (sv_2mortal (gperl_new_object (res, FALSE)));
+	items++;
+	PUTBACK;
+	ax = (I32) (SP - PL_stack_base) - items + 1;
+
+	_prepare_c_invocation_info (&iinfo, plan, items, 0, NULL, NULL, NULL);
+	_marshal_c_args (&iinfo, ax, items, &instance, &local_error_address);
+	SPAGAIN;
+	SP -= items;
 	PUTBACK;
+
+	ffi_call ((ffi_cif *) &plan->cif, finish->func_pointer,
+	          &ffi_return_value, iinfo.args);
+	SPAGAIN;
+
+	invoke_free_after_call_handlers (&iinfo.base);
+
+	if (local_error)
+		g_propagate_error (error, local_error);
+	else
+		SP = _push_c_results (&iinfo, &ffi_return_value, SP);
+	_clear_c_invocation_info (&iinfo);
+
+	return SP;
+}
+
+/* Resolves or fails future with what the finish function returns; see
+ * sv_to_callback. */
+static void
+invoke_finish_into_future (const GPerlI11nFunctionEntry *finish,
+                           GObject *source_object,
+                           GObject *res,
+                           SV *future)
+{
+	GError *error = NULL;
+	const char *method;
+	dSP;
+
+	ENTER;
+	SAVETMPS;
+
+	PUSHMARK (SP);
+	XPUSHs (future);
+	PUTBACK;
+	SP = _call_finish_function (finish, source_object, res, &error, SP);
+	if (error) {
+		XPUSHs (sv_2mortal (gperl_sv_from_gerror (error)));
+		g_error_free (error);
+		method = "_fail";
+	} else {
+		method = "_resolve";
+	}
+	PUTBACK;
+	call_method (method, G_DISCARD | G_EVAL);
+	if (SvTRUE (ERRSV))
+		gperl_run_exception_handlers ();
+
+	FREETMPS;
+	LEAVE;
+}
+
+/* Returns a new future that is resolved with the results of the call. */
+static SV *
+invoke_c_code_async (const GPerlI11nCPlan *plan,
+                     gpointer func_pointer,
+                     SV **sp, I32 ax, SV **mark, I32 items, /* these correspond to dXSARGS */
+                     UV internal_stack_offset,
+                     const gchar *package,
+                     const gchar *namespace,
+                     const gchar *function)
+{
+	GPerlI11nAsyncCCall *call;
+	SV *future;
+	I32 i;
+
+	PERL_UNUSED_VAR (sp);
+	PERL_UNUSED_VAR (mark);
+
+	if (plan->takes_callback)
+		ccroak ("%s takes a callback and thus cannot be invoked "
+		        "asynchronously", function);
+	/* Perl would not know that the pool thread still uses what it hands
+	 * over, and might free it while the call runs. */
+	if (plan->passes_ownership)
+		ccroak ("%s takes ownership of some of its args and thus cannot "
+		        "be invoked asynchronously", function);
+	if (!plan->cif_is_prepared)
+		ccroak ("Could not prepare a call interface");
+
+	call = g_new0 (GPerlI11nAsyncCCall, 1);
+	call->func_pointer = func_pointer;
+	call->local_error_address = &call->local_error;
+	call->keep_alive = newAV ();
+#ifdef PERL_IMPLICIT_CONTEXT
+	call->priv = aTHX;
+#endif
+
+	ENTER;
+	SAVETMPS;
+	SAVEDESTRUCTOR_X (_abandon_async_c_call, call);
+
+	/* Marshal private copies of the args: the caller may change its
+	 * variables while the call runs, and some marshallers hand out
+	 * pointers into the SVs' buffers. */
+	for (i = (I32) internal_stack_offset; i < items; i++)
+		ST (i) = sv_2mortal (newSVsv (ST (i)));
+
+	_prepare_c_invocation_info (&call->iinfo, plan, items,
+	                            internal_stack_offset,
+	                            package, namespace, function);
+	_check_n_args (&call->iinfo);
+	_marshal_c_args (&call->iinfo, ax, items,
+	                 &call->instance, &call->local_error_address);
+
+	/* The target names are only needed for error messages while
+	 * marshalling and might not outlive this call. */
+	call->iinfo.target_package = NULL;
+	call->iinfo.target_namespace = NULL;
+	call->iinfo.target_function = NULL;
+
+	/* Everything the marshalled args point into was created as a
+	 * temporary in the current scope; keep it alive until the call is
+	 * complete. */
+	for (i = PL_tmps_floor + 1; i <= PL_tmps_ix; i++) {
+		if (PL_tmps_stack[i])
+			av_push (call->keep_alive, SvREFCNT_inc (PL_tmps_stack[i]));
+	}
+
+	future = new_future ();
+	call->future = SvREFCNT_inc (future);
+	call->context = g_main_context_ref_thread_default ();
+	call->is_started = TRUE;
+
+	FREETMPS;
+	LEAVE;
+
+	/* Callbacks the C code reaches on the pool threads must run on
+	 * this interpreter's thread.  The hold is released in
+	 * _complete_async_c_call. */
+	hold_foreign_thread_dispatch (call->priv, TRUE);
+
+	G_LOCK (async_c_calls);
+	if (!async_c_call_pool)
+		async_c_call_pool = g_thread_pool_new (_run_async_c_call, NULL,
+		                                       (gint) g_get_num_processors (),
+		                                       FALSE, NULL);
+	G_UNLOCK (async_c_calls);
+	g_thread_pool_push (async_c_call_pool, call, NULL);
+
+	return future;
 }
 
 /* ------------------------------------------------------------------------- */
 
+/* Parallel invocation: a function is called once per tuple of args.  All
+ * calls are marshalled up front, the ffi calls are then spread over the
+ * calling thread and the threads of a shared pool, and the results are
+ * converted once all calls are complete.  The threads claim calls one at a
+ * time through a shared atomic counter, so uneven calls still keep all
+ * threads busy. */
+
+typedef struct {
+	GPerlI11nCInvocationInfo iinfo;
+	gpointer instance;
+	GError *local_error;
+	gpointer local_error_address;
+#if GI_CHECK_VERSION (1, 32, 0)
+	GIFFIReturnValue ffi_return_value;
+#else
+	GIArgument ffi_return_value;
+#endif
+} GPerlI11nParallelCall;
+
+/* Shared with the pool threads.  A pool thread that starts only after all
+ * calls are complete merely drops its reference, so the job is refcounted
+ * while the calls themselves are owned by the calling thread. */
+typedef struct {
+	gint ref_count;
+	const GPerlI11nCPlan *plan;
+	gpointer func_pointer;
+	GPerlI11nParallelCall *calls;
+	gint n_calls;
+	gint next_call;
+	gint n_done;
+	GMutex mutex;
+	GCond cond;
+} GPerlI11nParallelJob;
+
+typedef struct {
+	GPerlI11nParallelCall *calls;
+	gint n_prepared;
+} GPerlI11nParallelCalls;
+
+G_LOCK_DEFINE_STATIC (parallel_c_calls);
+static GThreadPool *parallel_c_call_pool = NULL;
+
 static void
-_prepare_c_invocation_info (GPerlI11nCInvocationInfo *iinfo,
-                            GICallableInfo *info,
-                            IV items,
-                            UV internal_stack_offset,
-                            const gchar *package,
-                            const gchar *namespace,
-                            const gchar *function)
+_parallel_job_unref (GPerlI11nParallelJob *job)
 {
+	if (g_atomic_int_dec_and_test (&job->ref_count)) {
+		g_mutex_clear (&job->mutex);
+		g_cond_clear (&job->cond);
+		g_free (job);
+	}
+}
+
+static void
+_run_parallel_calls (GPerlI11nParallelJob *job)
+{
+	gint i;
+	while ((i = g_atomic_int_add (&job->next_call, 1)) < job->n_calls) {
+		GPerlI11nParallelCall *call = &job->calls[i];
+		ffi_call ((ffi_cif *) &job->plan->cif, job->func_pointer,
+		          &call->ffi_return_value, call->iinfo.args);
+		g_mutex_lock (&job->mutex);
+		if (++job->n_done == job->n_calls)
+			g_cond_signal (&job->cond);
+		g_mutex_unlock (&job->mutex);
+	}
+}
+
+static void
+_run_parallel_worker (gpointer data, gpointer user_data)
+{
+	GPerlI11nParallelJob *job = data;
+	PERL_UNUSED_VAR (user_data);
+	_run_parallel_calls (job);
+	_parallel_job_unref (job);
+}
+
+static void
+_free_parallel_calls (pTHX_ void *data)
+{
+	GPerlI11nParallelCalls *calls = data;
+	gint i;
+	PERL_UNUSED_CONTEXT;
+	for (i = 0; i < calls->n_prepared; i++) {
+		_clear_c_invocation_info (&calls->calls[i].iinfo);
+		if (calls->calls[i].local_error)
+			g_error_free (calls->calls[i].local_error);
+	}
+	g_free (calls->calls);
+	g_free (calls);
+}
+
+/* Returns a new array with one array ref of results per tuple. */
+static AV *
+invoke_c_code_parallel (const GPerlI11nCPlan *plan,
+                        gpointer func_pointer,
+                        AV *arg_tuples,
+                        const gchar *package,
+                        const gchar *namespace,
+                        const gchar *function)
+{
+	GPerlI11nParallelCalls *calls;
+	GPerlI11nParallelJob *job;
+	GPerlI11nParallelCall *first_error = NULL;
+	AV *results;
+	gint n_calls, n_helpers, i;
+	dSP;
+
+	if (plan->takes_callback)
+		ccroak ("%s takes a callback and thus cannot be invoked "
+		        "in parallel", function);
+	if (plan->passes_ownership)
+		ccroak ("%s takes ownership of some of its args and thus cannot "
+		        "be invoked in parallel", function);
+	if (!plan->cif_is_prepared)
+		ccroak ("Could not prepare a call interface");
+
+	n_calls = av_len (arg_tuples) + 1;
+	results = newAV ();
+	if (n_calls == 0)
+		return results;
+	sv_2mortal ((SV *) results);
+
+	ENTER;
+	calls = g_new0 (GPerlI11nParallelCalls, 1);
+	calls->calls = g_new0 (GPerlI11nParallelCall, n_calls);
+	SAVEDESTRUCTOR_X (_free_parallel_calls, calls);
+
+	/* Marshal each tuple from the stack, as for a regular call.  The
+	 * temporaries this creates live until the end of the statement, and
+	 * thus until the results are converted. */
+	for (i = 0; i < n_calls; i++) {
+		GPerlI11nParallelCall *call = &calls->calls[i];
+		SV **svp = av_fetch (arg_tuples, i, 0);
+		AV *tuple;
+		I32 ax, n_args, j;
+
+		if (!svp || !gperl_sv_is_array_ref (*svp))
+			ccroak ("argument tuple %d is not an array reference", i);
+		tuple = (AV *) SvRV (*svp);
+		n_args = av_len (tuple) + 1;
+
+		EXTEND (SP, n_args);
+		for (j = 0; j < n_args; j++) {
+			SV **arg = av_fetch (tuple, j, 0);
+			PUSHs (arg ? *arg : &PL_sv_undef);
+		}
+		PUTBACK;
+		ax = (I32) (SP - PL_stack_base) - n_args + 1;
+
+		_prepare_c_invocation_info (&call->iinfo, plan, n_args, 0,
+		                            package, namespace, function);
+		calls->n_prepared++;
+		_check_n_args (&call->iinfo);
+		call->local_error_address = &call->local_error;
+		_marshal_c_args (&call->iinfo, ax, n_args,
+		                 &call->instance, &call->local_error_address);
+
+		SPAGAIN;
+		SP -= n_args;
+		PUTBACK;
+	}
+
+	job = g_new0 (GPerlI11nParallelJob, 1);
+	job->plan = plan;
+	job->func_pointer = func_pointer;
+	job->calls = calls->calls;
+	job->n_calls = n_calls;
+	g_mutex_init (&job->mutex);
+	g_cond_init (&job->cond);
+
+	n_helpers = MIN ((gint) g_get_num_processors (), n_calls) - 1;
+	job->ref_count = 1 + n_helpers;
+	if (n_helpers > 0) {
+		G_LOCK (parallel_c_calls);
+		if (!parallel_c_call_pool)
+			parallel_c_call_pool =
+				g_thread_pool_new (_run_parallel_worker, NULL,
+				                   (gint) g_get_num_processors (),
+				                   FALSE, NULL);
+		G_UNLOCK (parallel_c_calls);
+		for (i = 0; i < n_helpers; i++)
+			g_thread_pool_push (parallel_c_call_pool, job, NULL);
+	}
+
+	_run_parallel_calls (job);
+	g_mutex_lock (&job->mutex);
+	while (job->n_done < job->n_calls)
+		g_cond_wait (&job->cond, &job->mutex);
+	g_mutex_unlock (&job->mutex);
+	_parallel_job_unref (job);
+
+	for (i = 0; i < n_calls; i++)
+		invoke_free_after_call_handlers (&calls->calls[i].iinfo.base);
+
+	/* Convert the results of all successful calls, so that those that C
+	 * handed over are owned by Perl, before reporting the first error.
+	 * Failed calls leave their results unset. */
+	for (i = 0; i < n_calls; i++) {
+		GPerlI11nParallelCall *call = &calls->calls[i];
+		I32 base = (I32) (SP - PL_stack_base);
+		if (call->local_error) {
+			if (!first_error)
+				first_error = call;
+			continue;
+		}
+		SP = _push_c_results (&call->iinfo, &call->ffi_return_value, SP);
+		av_push (results,
+		         newRV_noinc ((SV *) av_make ((I32) (SP - PL_stack_base) - base,
+		                                      PL_stack_base + base + 1)));
+		SP = PL_stack_base + base;
+		PUTBACK;
+	}
+	if (first_error) {
+		GError *error = first_error->local_error;
+		first_error->local_error = NULL;
+		gperl_croak_gerror (NULL, error);
+	}
+
+	LEAVE;
+
+	return (AV *) SvREFCNT_inc (results);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Bulk async dispatching: an *_async function is started once per tuple of
+ * args, with at most max_in_flight operations running at a time.  Their
+ * GAsyncReadyCallbacks natively call the *_finish function and queue the
+ * results; see sv_to_callback.  A flush on the main context that was the
+ * thread-default one at call time then starts further operations and hands
+ * the queued results to Perl in batches.  Operations are started through an
+ * anonymous XSUB called with G_EVAL, so that a croak while marshalling a
+ * tuple only fails that tuple. */
+
+struct _GPerlI11nAsyncBulk {
+	const GPerlI11nFunctionEntry *entry;
+	gchar *package;
+	gchar *namespace;
+	gchar *function;
+
+	AV *tuples;
+	gint n_total;
+	gint next;
+	gint n_in_flight;
+	gint n_done;
+	gint max_in_flight;
+	gint batch_size;
+
+	/* results not handed to Perl yet; each one is [index, error, results] */
+	AV *pending;
+	/* collects all results if there is no batch handler */
+	AV *all;
+	SV *on_batch;
+	SV *future;
+
+	gboolean flush_scheduled;
+	GMainContext *context;
+	/* the anonymous XSUB that starts operations, see
+	 * _start_async_bulk_op_xsub */
+	CV *starter;
+	gpointer priv;
+};
+
+typedef struct {
+	GPerlI11nCInvocationInfo iinfo;
+	gboolean is_started;
+} GPerlI11nAsyncBulkOp;
+
+static gboolean _flush_async_bulk (gpointer data);
+
+static void
+_schedule_async_bulk_flush (GPerlI11nAsyncBulk *bulk)
+{
+	GSource *source;
+	if (bulk->flush_scheduled)
+		return;
+	bulk->flush_scheduled = TRUE;
+	source = g_idle_source_new ();
+	g_source_set_priority (source, G_PRIORITY_DEFAULT);
+	g_source_set_callback (source, _flush_async_bulk, bulk, NULL);
+	g_source_attach (source, bulk->context);
+	g_source_unref (source);
+}
+
+static void
+_free_async_bulk (GPerlI11nAsyncBulk *bulk)
+{
+	dTHXa (bulk->priv);
+	g_free (bulk->package);
+	g_free (bulk->namespace);
+	g_free (bulk->function);
+	SvREFCNT_dec (bulk->tuples);
+	SvREFCNT_dec (bulk->pending);
+	if (bulk->all)
+		SvREFCNT_dec (bulk->all);
+	if (bulk->on_batch)
+		SvREFCNT_dec (bulk->on_batch);
+	SvREFCNT_dec (bulk->future);
+	SvREFCNT_dec ((SV *) bulk->starter);
+	g_main_context_unref (bulk->context);
+	g_free (bulk);
+}
+
+/* Takes ownership of error and of the results. */
+static void
+_queue_async_bulk_result (GPerlI11nAsyncBulk *bulk, gint index,
+                          SV *error, SV **results, gint n_results)
+{
+	AV *record = newAV ();
+	gint i;
+	av_push (record, newSViv (index));
+	av_push (record, error ? error : newSV (0));
+	for (i = 0; i < n_results; i++)
+		av_push (record, results[i]);
+	av_push (bulk->pending, newRV_noinc ((SV *) record));
+	bulk->n_done++;
+	_schedule_async_bulk_flush (bulk);
+}
+
+/* Called by the native GAsyncReadyCallback of an operation. */
+static void
+complete_async_bulk_op (GPerlI11nAsyncBulk *bulk,
+                        gint index,
+                        const GPerlI11nFunctionEntry *finish,
+                        GObject *source_object,
+                        GObject *res)
+{
+	GError *error = NULL;
+	I32 base;
+	dSP;
+
+	ENTER;
+	SAVETMPS;
+
+	base = (I32) (SP - PL_stack_base);
+	SP = _call_finish_function (finish, source_object, res, &error, SP);
+	bulk->n_in_flight--;
+	if (error) {
+		_queue_async_bulk_result (bulk, index,
+		                          gperl_sv_from_gerror (error), NULL, 0);
+		g_error_free (error);
+	} else {
+		gint n_results = (gint) (SP - PL_stack_base) - base, i;
+		SV **results = g_newa (SV *, n_results + 1);
+		for (i = 0; i < n_results; i++)
+			results[i] = newSVsv (PL_stack_base[base + 1 + i]);
+		_queue_async_bulk_result (bulk, index, NULL, results, n_results);
+	}
+	SP = PL_stack_base + base;
+	PUTBACK;
+
+	FREETMPS;
+	LEAVE;
+}
+
+/* Runs when the scope of _start_async_bulk_op is left.  If the operation was
+ * not started, the callbacks set up while marshalling were never handed to C,
+ * so they are released, too. */
+static void
+_clear_async_bulk_op (pTHX_ void *data)
+{
+	GPerlI11nAsyncBulkOp *op = data;
+	PERL_UNUSED_CONTEXT;
+	if (!op->is_started) {
+		GSList *l;
+		for (l = op->iinfo.base.callback_infos; l != NULL; l = l->next) {
+			GPerlI11nPerlCallbackInfo *info = l->data;
+			if (info->finish)
+				release_perl_callback (info);
+			else if (info->free_after_use)
+				finish_async_perl_callback (info);
+		}
+	}
+	invoke_free_after_call_handlers (&op->iinfo.base);
+	_clear_c_invocation_info (&op->iinfo);
+}
+
+/* Starts the operation for the tuple at index.  Croaks if the tuple cannot be
+ * marshalled. */
+static void
+_start_async_bulk_op (GPerlI11nAsyncBulk *bulk, gint index)
+{
+	const GPerlI11nCPlan *plan = bulk->entry->plan;
+	GPerlI11nAsyncBulkOp op;
+	gpointer instance = NULL;
+#if GI_CHECK_VERSION (1, 32, 0)
+	GIFFIReturnValue ffi_return_value;
+#else
+	GIArgument ffi_return_value;
+#endif
+	GError *local_error = NULL;
+	gpointer local_error_address = &local_error;
+	GPerlI11nPerlCallbackInfo *finish_info = NULL;
+	SV **svp;
+	AV *tuple;
+	GSList *l;
+	I32 ax, n_args, i;
+	dSP;
+
+	svp = av_fetch (bulk->tuples, index, 0);
+	if (!svp || !gperl_sv_is_array_ref (*svp))
+		ccroak ("argument tuple %d is not an array reference", index);
+	tuple = (AV *) SvRV (*svp);
+	n_args = av_len (tuple) + 1;
+
+	ENTER;
+	SAVETMPS;
+
+	EXTEND (SP, n_args);
+	for (i = 0; i < n_args; i++) {
+		SV **arg = av_fetch (tuple, i, 0);
+		PUSHs (arg ? *arg : &PL_sv_undef);
+	}
+	PUTBACK;
+	ax = (I32) (SP - PL_stack_base) - n_args + 1;
+
+	/* The callback is left out, so sv_to_callback sets up a native one
+	 * that would resolve a future; redirect it to us. */
+	_prepare_c_invocation_info (&op.iinfo, plan, n_args, 0,
+	                            bulk->package, bulk->namespace,
+	                            bulk->function);
+	op.is_started = FALSE;
+	SAVEDESTRUCTOR_X (_clear_async_bulk_op, &op);
+	_check_n_args (&op.iinfo);
+	_marshal_c_args (&op.iinfo, ax, n_args, &instance, &local_error_address);
+	SPAGAIN;
+	SP -= n_args;
+	PUTBACK;
+
+	for (l = op.iinfo.base.callback_infos; l != NULL; l = l->next) {
+		GPerlI11nPerlCallbackInfo *info = l->data;
+		if (info->finish)
+			finish_info = info;
+	}
+	if (!finish_info)
+		ccroak ("argument tuple %d: the callback must be left out",
+		        index);
+	SvREFCNT_dec (finish_info->future);
+	finish_info->future = NULL;
+	finish_info->bulk = bulk;
+	finish_info->bulk_index = index;
+	SvREFCNT_dec (op.iinfo.base.future);
+	op.iinfo.base.future = NULL;
+
+	op.is_started = TRUE;
+	ffi_call ((ffi_cif *) &plan->cif, bulk->entry->func_pointer,
+	          &ffi_return_value, op.iinfo.args);
+	bulk->n_in_flight++;
+
+	if (local_error)
+		g_error_free (local_error);
+
+	FREETMPS;
+	LEAVE;
+}
+
+/* Called with the index of the tuple to start; the bulk is kept in the
+ * XSUB's CvXSUBANY, so that Perl code never gets to see its address. */
+XS_INTERNAL (_start_async_bulk_op_xsub)
+{
+	dXSARGS;
+	GPerlI11nAsyncBulk *bulk = CvXSUBANY (cv).any_ptr;
+	if (items != 1)
+		croak_xs_usage (cv, "index");
+	_start_async_bulk_op (bulk, (gint) SvIV (ST (0)));
+	XSRETURN_EMPTY;
+}
+
+static void
+_deliver_async_bulk_results (GPerlI11nAsyncBulk *bulk)
+{
+	while (av_len (bulk->pending) >= 0) {
+		AV *batch = newAV ();
+		gint i;
+		dSP;
+
+		for (i = 0; i < bulk->batch_size && av_len (bulk->pending) >= 0; i++)
+			av_push (batch, av_shift (bulk->pending));
+
+		if (!bulk->on_batch) {
+			for (i = 0; i <= av_len (batch); i++) {
+				SV *record = *av_fetch (batch, i, 0);
+				SV *index = *av_fetch ((AV *) SvRV (record), 0, 0);
+				av_store (bulk->all, SvIV (index),
+				          SvREFCNT_inc (record));
+			}
+			SvREFCNT_dec (batch);
+			continue;
+		}
+
+		ENTER;
+		SAVETMPS;
+		PUSHMARK (SP);
+		XPUSHs (sv_2mortal (newRV_noinc ((SV *) batch)));
+		PUTBACK;
+		call_sv (bulk->on_batch, G_DISCARD | G_EVAL);
+		if (SvTRUE (ERRSV))
+			gperl_run_exception_handlers ();
+		FREETMPS;
+		LEAVE;
+	}
+}
+
+static gboolean
+_flush_async_bulk (gpointer data)
+{
+	GPerlI11nAsyncBulk *bulk = data;
+	dTHXa (bulk->priv);
+
+	bulk->flush_scheduled = FALSE;
+
+	while (bulk->n_in_flight < bulk->max_in_flight &&
+	       bulk->next < bulk->n_total)
+	{
+		gint index = bulk->next++;
+		dSP;
+		ENTER;
+		SAVETMPS;
+		PUSHMARK (SP);
+		XPUSHs (sv_2mortal (newSViv (index)));
+		PUTBACK;
+		call_sv ((SV *) bulk->starter, G_DISCARD | G_EVAL);
+		if (SvTRUE (ERRSV))
+			_queue_async_bulk_result (bulk, index, newSVsv (ERRSV),
+			                          NULL, 0);
+		FREETMPS;
+		LEAVE;
+	}
+
+	_deliver_async_bulk_results (bulk);
+
+	/* A flush scheduled meanwhile takes care of the rest. */
+	if (bulk->n_done == bulk->n_total && !bulk->flush_scheduled) {
+		dSP;
+		ENTER;
+		SAVETMPS;
+		PUSHMARK (SP);
+		XPUSHs (bulk->future);
+		if (bulk->all)
+			XPUSHs (sv_2mortal (newRV_inc ((SV *) bulk->all)));
+		else
+			XPUSHs (sv_2mortal (newSViv (bulk->n_total)));
+		PUTBACK;
+		call_method ("_resolve", G_DISCARD | G_EVAL);
+		if (SvTRUE (ERRSV))
+			gperl_run_exception_handlers ();
+		FREETMPS;
+		LEAVE;
+		_free_async_bulk (bulk);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Returns a new future that is resolved once all operations are complete. */
+static SV *
+invoke_c_code_async_bulk (const GPerlI11nFunctionEntry *entry,
+                          AV *arg_tuples,
+                          gint max_in_flight,
+                          gint batch_size,
+                          SV *on_batch,
+                          const gchar *package,
+                          const gchar *namespace,
+                          const gchar *function)
+{
+	GPerlI11nAsyncBulk *bulk;
+	gboolean has_finish = FALSE;
 	guint i;
 
-	prepare_invocation_info ((GPerlI11nInvocationInfo *) iinfo, info);
+	for (i = 0; i < entry->plan->base.n_args && !has_finish; i++) {
+		GITypeInfo *arg_type = &entry->plan->base.arg_types[i];
+		GIBaseInfo *interface;
+		if (g_type_info_get_tag (arg_type) != GI_TYPE_TAG_INTERFACE ||
+		    g_arg_info_get_scope (&entry->plan->base.arg_infos[i]) != GI_SCOPE_TYPE_ASYNC)
+			continue;
+		interface = g_type_info_get_interface (arg_type);
+		has_finish = GI_IS_CALLBACK_INFO (interface) &&
+		             find_finish_function (entry->info, interface) != NULL;
+		g_base_info_unref (interface);
+	}
+	if (!has_finish)
+		ccroak ("%s is not an async function with a matching finish "
+		        "function", function);
+
+	bulk = g_new0 (GPerlI11nAsyncBulk, 1);
+	bulk->entry = entry;
+	bulk->package = g_strdup (package);
+	bulk->namespace = g_strdup (namespace);
+	bulk->function = g_strdup (function);
+	bulk->tuples = (AV *) SvREFCNT_inc (arg_tuples);
+	bulk->n_total = av_len (arg_tuples) + 1;
+	bulk->max_in_flight = MAX (max_in_flight, 1);
+	bulk->batch_size = MAX (batch_size, 1);
+	bulk->pending = newAV ();
+	if (gperl_sv_is_defined (on_batch))
+		bulk->on_batch = newSVsv (on_batch);
+	else
+		bulk->all = newAV ();
+	bulk->future = new_future ();
+	bulk->context = g_main_context_ref_thread_default ();
+	bulk->starter = newXS (NULL, _start_async_bulk_op_xsub, __FILE__);
+	CvXSUBANY (bulk->starter).any_ptr = bulk;
+#ifdef PERL_IMPLICIT_CONTEXT
+	bulk->priv = aTHX;
+#endif
 
-	dwarn ("%s::%s::%s => %s\n",
-	       package, namespace, function,
-	       g_base_info_get_name (info));
+	_schedule_async_bulk_flush (bulk);
 
-	iinfo->target_package = package;
-	iinfo->target_namespace = namespace;
-	iinfo->target_function = function;
+	return SvREFCNT_inc (bulk->future);
+}
 
-	iinfo->stack_offset = (guint) internal_stack_offset;
-	g_assert (items >= iinfo->stack_offset);
-	iinfo->n_given_args = ((guint) items) - iinfo->stack_offset;
-	iinfo->n_invoke_args = iinfo->base.n_args;
+/* ------------------------------------------------------------------------- */
+
+/* Caller owns return value. */
+static GPerlI11nCPlan *
+c_plan_new (GICallableInfo *info)
+{
+	GPerlI11nCPlan *plan;
+	guint i;
 
-	iinfo->is_constructor = FALSE;
-	if (iinfo->base.is_function) {
-		iinfo->is_constructor =
+	plan = g_new0 (GPerlI11nCPlan, 1);
+	plan_init ((GPerlI11nPlan *) plan, info);
+
+	dwarn ("%s\n", g_base_info_get_name (info));
+
+	plan->n_invoke_args = plan->base.n_args;
+
+	plan->is_constructor = FALSE;
+	if (plan->base.is_function) {
+		plan->is_constructor =
 			g_function_info_get_flags (info) & GI_FUNCTION_IS_CONSTRUCTOR;
 	}
 
 	/* FIXME: can a vfunc not throw? */
-	iinfo->throws = FALSE;
-	if (iinfo->base.is_function) {
-		iinfo->throws =
+	plan->throws = FALSE;
+	if (plan->base.is_function) {
+		plan->throws =
 			g_function_info_get_flags (info) & GI_FUNCTION_THROWS;
 	}
-	if (iinfo->throws) {
+	if (plan->throws) {
 		/* Add one for the implicit GError arg. */
-		iinfo->n_invoke_args++;
+		plan->n_invoke_args++;
 	}
 
-	if (iinfo->base.is_vfunc) {
-		iinfo->is_method = TRUE;
-	} else if (iinfo->base.is_callback) {
-		iinfo->is_method = FALSE;
+	if (plan->base.is_vfunc) {
+		plan->is_method = TRUE;
+	} else if (plan->base.is_callback) {
+		plan->is_method = FALSE;
 	} else {
-		iinfo->is_method =
+		plan->is_method =
 			(g_function_info_get_flags (info) & GI_FUNCTION_IS_METHOD)
-			&& !iinfo->is_constructor;
+			&& !plan->is_constructor;
 	}
-	if (iinfo->is_method) {
+	if (plan->is_method) {
 		/* Add one for the implicit invocant arg. */
-		iinfo->n_invoke_args++;
+		plan->n_invoke_args++;
 	}
 
-	dwarn ("  args = %u, given = %u, invoke = %u\n",
-	       iinfo->base.n_args,
-	       iinfo->n_given_args,
-	       iinfo->n_invoke_args);
+	dwarn ("  args = %u, invoke = %u\n",
+	       plan->base.n_args,
+	       plan->n_invoke_args);
 
 	dwarn ("  symbol = %s\n",
-	       iinfo->base.is_vfunc ? g_base_info_get_name (info) : g_function_info_get_symbol (info));
+	       plan->base.is_vfunc ? g_base_info_get_name (info) : g_function_info_get_symbol (info));
 
 	dwarn ("  is_constructor = %d, is_method = %d, throws = %d\n",
-	       iinfo->is_constructor, iinfo->is_method, iinfo->throws);
+	       plan->is_constructor, plan->is_method, plan->throws);
 
-	/* allocate enough space for all args in both the out and in lists.
-	 * we'll only use as much as we need.  since function argument lists
-	 * are typically small, this shouldn't be a big problem. */
-	if (iinfo->n_invoke_args) {
-		guint n = iinfo->n_invoke_args;
-		iinfo->in_args = gperl_alloc_temp (sizeof (GIArgument) * n);
-		iinfo->out_args = gperl_alloc_temp (sizeof (GIArgument) * n);
-		iinfo->arg_types_ffi = gperl_alloc_temp (sizeof (ffi_type *) * n);
-		iinfo->args = gperl_alloc_temp (sizeof (gpointer) * n);
-		iinfo->is_automatic_arg = gperl_alloc_temp (sizeof (gboolean) * n);
+	if (plan->n_invoke_args) {
+		guint n = plan->n_invoke_args;
+		plan->is_automatic_arg = g_new0 (gboolean, n);
+		plan->arg_types_ffi = g_new0 (ffi_type *, n);
 	}
 
 	/* If we call a constructor, we skip the initial package name resulting
 	 * from the "Package->new" syntax.  If we call a method, we handle the
 	 * invocant separately. */
-	iinfo->constructor_offset = iinfo->is_constructor ? 1 : 0;
-	iinfo->method_offset = iinfo->is_method ? 1 : 0;
-	iinfo->dynamic_stack_offset = 0;
+	plan->constructor_offset = plan->is_constructor ? 1 : 0;
+	plan->method_offset = plan->is_method ? 1 : 0;
 
 	/* Make a first pass to mark args that are filled in automatically, and
 	 * thus have no counterpart on the Perl side. */
-	for (i = 0 ; i < iinfo->base.n_args ; i++) {
-		GIArgInfo * arg_info = &(iinfo->base.arg_infos[i]);
-		GITypeInfo * arg_type = &(iinfo->base.arg_types[i]);
+	for (i = 0 ; i < plan->base.n_args ; i++) {
+		GIArgInfo * arg_info = &(plan->base.arg_infos[i]);
+		GITypeInfo * arg_type = &(plan->base.arg_types[i]);
 		GITypeTag arg_tag = g_type_info_get_tag (arg_type);
 
 		if (arg_tag == GI_TYPE_TAG_ARRAY) {
 			gint pos = g_type_info_get_array_length (arg_type);
 			if (pos >= 0) {
 				dwarn ("  pos %d is automatic (array length)\n", pos);
-				iinfo->is_automatic_arg[pos] = TRUE;
+				plan->is_automatic_arg[pos] = TRUE;
 			}
 		}
 
@@ -399,9 +1325,10 @@ _prepare_c_invocation_info (GPerlI11nCInvocationInfo *iinfo,
 			GIInfoType info_type = g_base_info_get_type (interface);
 			if (info_type == GI_INFO_TYPE_CALLBACK) {
 				gint pos = g_arg_info_get_destroy (arg_info);
+				plan->takes_callback = TRUE;
 				if (pos >= 0) {
 					dwarn ("  pos %d is automatic (callback destroy notify)\n", pos);
-					iinfo->is_automatic_arg[pos] = TRUE;
+					plan->is_automatic_arg[pos] = TRUE;
 				}
 			}
 			g_base_info_unref ((GIBaseInfo *) interface);
@@ -409,35 +1336,41 @@ _prepare_c_invocation_info (GPerlI11nCInvocationInfo *iinfo,
 	}
 
 	/* Make another pass to count the expected args. */
-	iinfo->n_expected_args = iinfo->constructor_offset + iinfo->method_offset;
-	iinfo->n_nullable_args = 0;
-	for (i = 0 ; i < iinfo->base.n_args ; i++) {
-		GIArgInfo * arg_info = &(iinfo->base.arg_infos[i]);
-		GITypeInfo * arg_type = &(iinfo->base.arg_types[i]);
+	plan->n_expected_args = plan->constructor_offset + plan->method_offset;
+	plan->n_nullable_args = 0;
+	for (i = 0 ; i < plan->base.n_args ; i++) {
+		GIArgInfo * arg_info = &(plan->base.arg_infos[i]);
+		GITypeInfo * arg_type = &(plan->base.arg_types[i]);
 		GITypeTag arg_tag = g_type_info_get_tag (arg_type);
 		gboolean is_out = GI_DIRECTION_OUT == g_arg_info_get_direction (arg_info);
-		gboolean is_automatic = iinfo->is_automatic_arg[i];
+		gboolean is_automatic = plan->is_automatic_arg[i];
 		gboolean is_skipped = FALSE;
 #if GI_CHECK_VERSION (1, 29, 0)
 		is_skipped = g_arg_info_is_skip (arg_info);
 #endif
 
 		if (!is_out && !is_automatic && !is_skipped)
-			iinfo->n_expected_args++;
+			plan->n_expected_args++;
+		if (!is_out &&
+		    g_arg_info_get_ownership_transfer (arg_info) != GI_TRANSFER_NOTHING &&
+		    (arg_tag == GI_TYPE_TAG_INTERFACE ||
+		     (!G_TYPE_TAG_IS_BASIC (arg_tag) &&
+		      g_arg_info_get_ownership_transfer (arg_info) == GI_TRANSFER_EVERYTHING)))
+			plan->passes_ownership = TRUE;
 		/* Callback user data may always be NULL. */
 		if (g_arg_info_may_be_null (arg_info) || arg_tag == GI_TYPE_TAG_VOID)
-			iinfo->n_nullable_args++;
+			plan->n_nullable_args++;
 	}
 
 	/* If the return value is an array which comes with an outbound length
 	 * arg, then mark that length arg as automatic, too. */
-	if (g_type_info_get_tag (&iinfo->base.return_type_info) == GI_TYPE_TAG_ARRAY) {
-		gint pos = g_type_info_get_array_length (&iinfo->base.return_type_info);
+	if (g_type_info_get_tag (&plan->base.return_type_info) == GI_TYPE_TAG_ARRAY) {
+		gint pos = g_type_info_get_array_length (&plan->base.return_type_info);
 		if (pos >= 0) {
-			GIArgInfo * arg_info = &(iinfo->base.arg_infos[pos]);
+			GIArgInfo * arg_info = &(plan->base.arg_infos[pos]);
 			if (GI_DIRECTION_OUT == g_arg_info_get_direction (arg_info)) {
 				dwarn ("  pos %d is automatic (array length)\n", pos);
-				iinfo->is_automatic_arg[pos] = TRUE;
+				plan->is_automatic_arg[pos] = TRUE;
 			}
 		}
 	}
@@ -462,18 +1395,106 @@ _prepare_c_invocation_info (GPerlI11nCInvocationInfo *iinfo,
 	 * reference on to us, or a constructor of a GInitiallyUnowned
 	 * descendant that returns a floating object but passes no reference on
 	 * to us, then we need to revisit this. */
-	if (iinfo->is_constructor &&
-	    g_type_info_get_tag (&iinfo->base.return_type_info) == GI_TYPE_TAG_INTERFACE)
+	if (plan->is_constructor &&
+	    g_type_info_get_tag (&plan->base.return_type_info) == GI_TYPE_TAG_INTERFACE)
 	{
-		GIBaseInfo * interface = g_type_info_get_interface (&iinfo->base.return_type_info);
+		GIBaseInfo * interface = g_type_info_get_interface (&plan->base.return_type_info);
 		if (GI_IS_REGISTERED_TYPE_INFO (interface) &&
 		    g_type_is_a (get_gtype (interface),
 		                 G_TYPE_INITIALLY_UNOWNED))
 		{
-			iinfo->base.return_type_transfer = GI_TRANSFER_EVERYTHING;
+			plan->base.return_type_transfer = GI_TRANSFER_EVERYTHING;
 		}
 		g_base_info_unref ((GIBaseInfo *) interface);
 	}
+
+	/* Determine the ffi types of all the args the C function receives and
+	 * prepare the call interface. */
+	if (plan->is_method)
+		plan->arg_types_ffi[0] = &ffi_type_pointer;
+	for (i = 0 ; i < plan->base.n_args ; i++) {
+		GIArgInfo * arg_info = &(plan->base.arg_infos[i]);
+		guint ffi_stack_pos = i + plan->method_offset;
+		plan->arg_types_ffi[ffi_stack_pos] =
+			GI_DIRECTION_IN == g_arg_info_get_direction (arg_info)
+			? g_type_info_get_ffi_type (&(plan->base.arg_types[i]))
+			: &ffi_type_pointer;
+	}
+	if (plan->throws)
+		plan->arg_types_ffi[plan->n_invoke_args - 1] = &ffi_type_pointer;
+	plan->cif_is_prepared =
+		FFI_OK == ffi_prep_cif (&plan->cif, FFI_DEFAULT_ABI,
+		                        plan->n_invoke_args,
+		                        plan->base.return_type_ffi,
+		                        plan->arg_types_ffi);
+
+	return plan;
+}
+
+static void
+c_plan_free (GPerlI11nCPlan *plan)
+{
+	g_free (plan->is_automatic_arg);
+	g_free (plan->arg_types_ffi);
+	plan_clear ((GPerlI11nPlan *) plan);
+	g_free (plan);
+}
+
+static void
+_prepare_c_invocation_info (GPerlI11nCInvocationInfo *iinfo,
+                            const GPerlI11nCPlan *plan,
+                            IV items,
+                            UV internal_stack_offset,
+                            const gchar *package,
+                            const gchar *namespace,
+                            const gchar *function)
+{
+	prepare_invocation_info_from_plan ((GPerlI11nInvocationInfo *) iinfo,
+	                                   (const GPerlI11nPlan *) plan);
+
+	dwarn ("%s::%s::%s => %s\n",
+	       package, namespace, function,
+	       g_base_info_get_name (plan->base.interface));
+
+	iinfo->plan = plan;
+
+	iinfo->target_package = package;
+	iinfo->target_namespace = namespace;
+	iinfo->target_function = function;
+
+	iinfo->stack_offset = (guint) internal_stack_offset;
+	g_assert (items >= iinfo->stack_offset);
+	iinfo->n_given_args = ((guint) items) - iinfo->stack_offset;
+
+	iinfo->is_constructor = plan->is_constructor;
+	iinfo->is_method = plan->is_method;
+	iinfo->throws = plan->throws;
+
+	iinfo->n_invoke_args = plan->n_invoke_args;
+	iinfo->n_nullable_args = plan->n_nullable_args;
+	iinfo->n_expected_args = plan->n_expected_args;
+
+	iinfo->is_automatic_arg = plan->is_automatic_arg;
+	iinfo->arg_types_ffi = plan->arg_types_ffi;
+
+	iinfo->constructor_offset = plan->constructor_offset;
+	iinfo->method_offset = plan->method_offset;
+	iinfo->dynamic_stack_offset = 0;
+
+	dwarn ("  args = %u, given = %u, invoke = %u\n",
+	       iinfo->base.n_args,
+	       iinfo->n_given_args,
+	       iinfo->n_invoke_args);
+
+	/* allocate enough space for all args in both the out and in lists.
+	 * we'll only use as much as we need.  since function argument lists
+	 * are typically small, this shouldn't be a big problem. */
+	if (iinfo->n_invoke_args) {
+		guint n = iinfo->n_invoke_args;
+		iinfo->in_args = gperl_alloc_temp (sizeof (GIArgument) * n);
+		iinfo->out_args = gperl_alloc_temp (sizeof (GIArgument) * n);
+		iinfo->args = gperl_alloc_temp (sizeof (gpointer) * n);
+	}
 }
 
 static void
@@ -564,7 +1585,9 @@ _handle_automatic_arg (guint pos,
 			 * specified undef for the callback or nothing at all,
 			 * in which case we must not install our destroy notify
 			 * handler. */
-			arg->v_pointer = cinfo->code ? release_perl_callback : NULL;
+			arg->v_pointer = cinfo->native_func
+				? (gpointer) cinfo->native_destroy
+				: cinfo->code ? release_perl_callback : NULL;
 			return;
 		}
 	}
@@ -1,33 +1,74 @@
 /* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
 
 static void _prepare_perl_invocation_info (GPerlI11nPerlInvocationInfo *iinfo,
-                                           GICallableInfo *info,
+                                           const GPerlI11nPerlPlan *plan,
                                            gpointer *args);
 static void _clear_perl_invocation_info (GPerlI11nPerlInvocationInfo *iinfo);
 static void _fill_ffi_return_value (GITypeInfo *return_info,
                                     gpointer resp,
                                     GIArgument *arg);
+static CV * _resolve_method (GPerlI11nPerlCallbackInfo *info);
 
 
+static void _invoke_perl_code (GPerlI11nPerlCallbackInfo *info,
+                               const GPerlI11nPerlPlan *plan,
+                               gpointer *args,
+                               gpointer resp,
+                               GValue *return_gvalue);
+
+static const GPerlI11nPerlPlan * _get_perl_plan (GPerlI11nPerlCallbackInfo *info);
+
 static void
 invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata)
 {
-	GPerlI11nPerlCallbackInfo *info;
+	GPerlI11nPerlCallbackInfo *info = userdata;
+	const GPerlI11nPerlPlan *plan = _get_perl_plan (info);
+	if (dispatch_foreign_perl_callback (info, plan, cif, resp, args))
+		return;
+	_invoke_perl_code (info, plan, args, resp, NULL);
+}
+
+/* Returns the plan for invoking info, creating it on first use. */
+static const GPerlI11nPerlPlan *
+_get_perl_plan (GPerlI11nPerlCallbackInfo *info)
+{
+	GPerlI11nPerlPlan *plan = g_atomic_pointer_get (&info->plan);
+	if (plan)
+		return plan;
+	plan = perl_plan_new (info->interface);
+	if (!g_atomic_pointer_compare_and_exchange (&info->plan, NULL, plan)) {
+		perl_plan_free (plan);
+		plan = g_atomic_pointer_get (&info->plan);
+	}
+	return plan;
+}
+
+/* args holds pointers to the values of the args, as handed to ffi closures.
+ * If plan is NULL, info's own plan is used.  If return_gvalue is non-NULL,
+ * the return value is stored in it instead of in resp. */
+static void
+_invoke_perl_code (GPerlI11nPerlCallbackInfo *info,
+                   const GPerlI11nPerlPlan *plan,
+                   gpointer *args,
+                   gpointer resp,
+                   GValue *return_gvalue)
+{
 	GICallableInfo *cb_interface;
 	GPerlI11nPerlInvocationInfo iinfo;
 	guint args_offset = 0, i;
 	guint in_inout;
-	guint n_return_values;
 	I32 n_returned;
-	I32 context;
 	SV *first_sv = NULL, *last_sv = NULL;
+	/* the instance and the args, if they are to be converted first */
+	SV **values = NULL;
+	gpointer *pointers = NULL;
 	dGPERL_CALLBACK_MARSHAL_SP;
 
-	PERL_UNUSED_VAR (cif);
-
-	/* unwrap callback info struct from userdata */
-	info = (GPerlI11nPerlCallbackInfo *) userdata;
 	cb_interface = (GICallableInfo *) info->interface;
+	if (!plan)
+		plan = _get_perl_plan (info);
+
+	release_finished_async_perl_callbacks ();
 
 	/* set perl context */
 	GPERL_CALLBACK_MARSHAL_INIT (info);
@@ -35,7 +76,7 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 	ENTER;
 	SAVETMPS;
 
-	_prepare_perl_invocation_info (&iinfo, cb_interface, args);
+	_prepare_perl_invocation_info (&iinfo, plan, args);
 
 	PUSHMARK (SP);
 
@@ -68,34 +109,34 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 		       info->data, info->swap_data);
 		dwarn ("instance = %p, data = %p, first = %p, last = %p\n",
 		       instance_sv, data_sv, first_sv, last_sv);
+		if (plan->conversion) {
+			/* the data stays in place, and the instance is
+			 * positioned by the conversion */
+			values = g_newa (SV *, iinfo.base.n_args + 1);
+			pointers = g_newa (gpointer, iinfo.base.n_args + 1);
+			memset (values, 0, sizeof (SV *) * (iinfo.base.n_args + 1));
+			memset (pointers, 0, sizeof (gpointer) * (iinfo.base.n_args + 1));
+			values[0] = sv_2mortal (instance_sv);
+			pointers[0] = CAST_RAW (args[0], gpointer);
+			if (info->swap_data)
+				last_sv = NULL;
+			else
+				first_sv = NULL;
+		}
 		if (first_sv)
 			XPUSHs (sv_2mortal (first_sv));
 	}
 
-	/* find arguments; use type information from interface to find in and
-	 * in-out args and their types, count in-out and out args, and find
-	 * suitable converters; push in and in-out arguments onto the perl
-	 * stack */
-	in_inout = 0;
+	/* push in and in-out arguments onto the perl stack, using the
+	 * converters and directions found in the plan */
 	for (i = 0; i < iinfo.base.n_args; i++) {
-		GIArgInfo *arg_info = &(iinfo.base.arg_infos[i]);
 		GITypeInfo *arg_type = &(iinfo.base.arg_types[i]);
-		GITransfer transfer = g_arg_info_get_ownership_transfer (arg_info);
-		GIDirection direction = g_arg_info_get_direction (arg_info);
+		GIDirection direction = plan->directions[i];
 
 		iinfo.base.current_pos = i;
 
-		dwarn ("arg %d: info = %p (%s)\n",
-		       i, arg_info, g_base_info_get_name (arg_info));
-		dwarn ("  dir = %d, is retval = %d, is optional = %d, may be null = %d, transfer = %d\n",
-		       direction,
-		       g_arg_info_is_return_value (arg_info),
-		       g_arg_info_is_optional (arg_info),
-		       g_arg_info_may_be_null (arg_info),
-		       transfer);
-		dwarn ("  arg type = %p, is pointer = %d, tag = %d (%s)\n",
-		       arg_type,
-		       g_type_info_is_pointer (arg_type),
+		dwarn ("arg %d: dir = %d, transfer = %d, tag = %d (%s)\n",
+		       i, direction, plan->transfers[i],
 		       g_type_info_get_tag (arg_type),
 		       g_type_tag_to_string (g_type_info_get_tag (arg_type)));
 
@@ -114,21 +155,31 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 			raw_to_arg (raw, &arg, arg_type);
 			sv = SAVED_STACK_SV (arg_to_sv (&arg,
 			                                arg_type,
-			                                transfer,
+			                                plan->transfers[i],
 			                                GPERL_I11N_MEMORY_SCOPE_IRRELEVANT,
 			                                &iinfo.base));
 			/* If arg_to_sv returns NULL, we take that as 'skip
 			 * this argument'; happens for GDestroyNotify, for
 			 * example. */
-			if (sv)
+			if (sv && values) {
+				values[i+1] = sv_2mortal (sv);
+				pointers[i+1] = arg.v_pointer;
+			} else if (sv) {
 				XPUSHs (sv_2mortal (sv));
+			}
 		}
+	}
+	in_inout = plan->n_in_inout;
 
-		if (direction == GI_DIRECTION_INOUT ||
-		    direction == GI_DIRECTION_OUT)
-		{
-			in_inout++;
-		}
+	if (values) {
+		const struct _GPerlI11nArgsConversion *conversion = plan->conversion;
+		SV **converted = g_newa (SV *, conversion->n_slots);
+		PUTBACK;
+		apply_args_conversion (conversion, values, pointers, converted);
+		SPAGAIN;
+		EXTEND (SP, (SSize_t) conversion->n_slots);
+		for (i = 0; i < conversion->n_slots; i++)
+			PUSHs (converted[i]);
 	}
 
 	/* push the last SV onto the stack; this might be the user data or the
@@ -147,31 +198,40 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 		SPAGAIN;
 	}
 
-	/* determine suitable Perl call context */
-	context = G_VOID | G_DISCARD;
-	if (iinfo.base.has_return_value) {
-		context = in_inout > 0
-		  ? G_ARRAY
-		  : G_SCALAR;
-	} else {
-		if (in_inout == 1) {
-			context = G_SCALAR;
-		} else if (in_inout > 1) {
-			context = G_ARRAY;
-		}
+	/* a coalesced handler only gets the args queued.  Handlers that are
+	 * to return values are refused when they are set up; if one gets
+	 * here anyway, it is called like any other, through its overloaded
+	 * code dereference. */
+	if (plan->n_return_values == 0 && is_coalesced_sv (info->code)) {
+		queue_coalesced_args (info->code);
+		_clear_perl_invocation_info (&iinfo);
+		FREETMPS;
+		LEAVE;
+		if (info->free_after_use)
+			finish_async_perl_callback (info);
+		return;
 	}
 
 	/* do the call, demand #in-out+#out+#return-value return values */
-	n_return_values = iinfo.base.has_return_value
-	  ? in_inout + 1
-	  : in_inout;
-	n_returned = info->sub_name
-		? call_method (info->sub_name, context)
-		: call_sv (info->code, context);
-	if (n_return_values != 0 && (n_returned < 0 || ((guint) n_returned) != n_return_values)) {
+	if (info->sub_name) {
+		CV *method = _resolve_method (info);
+		/* the cache's reference might go away during the call */
+		if (method) {
+			SvREFCNT_inc_simple_void_NN (method);
+			SAVEFREESV (method);
+		}
+		n_returned = method
+			? call_sv ((SV *) method, plan->context)
+			: call_method (info->sub_name, plan->context);
+	} else {
+		n_returned = call_sv (info->code, plan->context);
+	}
+	if (plan->n_return_values != 0 &&
+	    (n_returned < 0 || ((guint) n_returned) != plan->n_return_values))
+	{
 		ccroak ("callback returned %d values "
 		        "but is supposed to return %u values",
-		        n_returned, n_return_values);
+		        n_returned, plan->n_return_values);
 	}
 
 	/* call-scoped callback infos are freed by
@@ -184,7 +244,7 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 		SV **returned_values;
 		int out_index;
 
-		returned_values = g_new0 (SV *, in_inout);
+		returned_values = g_newa (SV *, in_inout);
 
 		/* pop scalars off the stack and put them into the array;
 		 * reverse the order since POPs pops items off of the end of
@@ -195,9 +255,8 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 
 		out_index = 0;
 		for (i = 0; i < iinfo.base.n_args; i++) {
-			GIArgInfo *arg_info = &(iinfo.base.arg_infos[i]);
 			GITypeInfo *arg_type = &(iinfo.base.arg_types[i]);
-			GIDirection direction = g_arg_info_get_direction (arg_info);
+			GIDirection direction = plan->directions[i];
 			gpointer out_pointer = * (gpointer *) args[i+args_offset];
 
 			if (!out_pointer) {
@@ -209,7 +268,7 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 			    direction == GI_DIRECTION_OUT)
 			{
 				GIArgument tmp_arg;
-				GITransfer transfer = g_arg_info_get_ownership_transfer (arg_info);
+				GITransfer transfer = plan->transfers[i];
 				/* g_arg_info_may_be_null (arg_info) is not
 				 * appropriate here as it describes whether the
 				 * out/inout arg itself may be NULL.  But we're
@@ -218,14 +277,14 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 				 * does not seem to be present in the typelib
 				 * (nor is there an annotation for it). */
 				gboolean may_be_null = TRUE;
-				gboolean is_caller_allocated = g_arg_info_is_caller_allocates (arg_info);
+				gboolean is_caller_allocated = plan->is_caller_allocated[i];
 				dwarn ("out/inout arg, pos = %d, is_caller_allocated = %d\n",
 				       i, is_caller_allocated);
 				if (is_caller_allocated) {
 					tmp_arg.v_pointer = out_pointer;
 				}
 				sv_to_arg (returned_values[out_index], &tmp_arg,
-				           arg_info, arg_type,
+				           &(iinfo.base.arg_infos[i]), arg_type,
 				           transfer, may_be_null, &iinfo.base);
 				if (!is_caller_allocated) {
 					arg_to_raw (&tmp_arg, out_pointer, arg_type);
@@ -233,12 +292,14 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 				out_index++;
 			}
 		}
-
-		g_free (returned_values);
 	}
 
-	/* store return value in resp, if any */
-	if (iinfo.base.has_return_value) {
+	/* store return value in resp or return_gvalue, if any */
+	if (iinfo.base.has_return_value && return_gvalue) {
+		SV *sv = POPs;
+		if (G_IS_VALUE (return_gvalue))
+			gperl_value_from_sv (return_gvalue, sv);
+	} else if (iinfo.base.has_return_value) {
 		GIArgument arg;
 		GITypeInfo *type_info;
 		GITransfer transfer;
@@ -246,7 +307,7 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 
 		type_info = &iinfo.base.return_type_info;
 		transfer = iinfo.base.return_type_transfer;
-		may_be_null = g_callable_info_may_return_null (cb_interface); /* FIXME */
+		may_be_null = plan->may_return_null; /* FIXME */
 
 		dwarn ("return value: type = %p\n", type_info);
 		dwarn ("  is pointer = %d, tag = %d (%s), transfer = %d\n",
@@ -267,16 +328,11 @@ invoke_perl_code (ffi_cif* cif, gpointer resp, gpointer* args, gpointer userdata
 	FREETMPS;
 	LEAVE;
 
-	/* FIXME: We can't just free everything here because ffi will use parts
-	 * of this after we've returned.
-	 *
-	 * if (info->free_after_use) {
-	 * 	release_callback (info);
-	 * }
-	 *
-	 * Gjs uses a global list of callback infos instead and periodically
-	 * frees unused ones.
-	 */
+	/* We can't just free everything here because ffi will use parts of
+	 * this after we've returned, so async-scoped callbacks are released
+	 * later. */
+	if (info->free_after_use)
+		finish_async_perl_callback (info);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -296,59 +352,105 @@ invoke_perl_signal_handler (ffi_cif* cif, gpointer resp, gpointer* args, gpointe
 	GPerlI11nPerlSignalInfo *signal_info = userdata;
 
 	GPerlClosure *perl_closure = (GPerlClosure *) closure;
-	GPerlI11nPerlCallbackInfo *cb_info;
-	GCClosure c_closure;
+	GPerlI11nPerlCallbackInfo cb_info;
+	const GPerlI11nPerlPlan *plan = signal_info->plan;
+	GIArgument *values;
+	gpointer *raw_args;
+	guint i;
 
 	PERL_UNUSED_VAR (cif);
 	PERL_UNUSED_VAR (resp);
+	PERL_UNUSED_VAR (invocation_hint);
+#ifndef PERL_IMPLICIT_CONTEXT
 	PERL_UNUSED_VAR (marshal_data);
+#endif
 
 	dwarn ("%s, n_args = %d\n",
 	       g_base_info_get_name (signal_info->interface),
-	       g_callable_info_get_n_args (signal_info->interface));
-
-	cb_info = create_perl_callback_closure (signal_info->interface,
-	                                        perl_closure->callback);
-	attach_perl_callback_data (cb_info, perl_closure->data);
-	cb_info->swap_data = GPERL_CLOSURE_SWAP_DATA (perl_closure);
-	if (signal_info->args_converter)
-		cb_info->args_converter = SvREFCNT_inc (signal_info->args_converter);
+	       plan->base.n_args);
+
+	if (n_param_values != plan->base.n_args + 1)
+		ccroak ("Signal %s was emitted with %u args, "
+		        "but is supposed to have %u",
+		        g_base_info_get_name (signal_info->interface),
+		        n_param_values - 1, plan->base.n_args);
+
+	/* The handler's code and data are owned by the GClosure, which is
+	 * alive for the duration of the emission, so they can simply be
+	 * borrowed. */
+	memset (&cb_info, 0, sizeof (cb_info));
+	cb_info.interface = signal_info->interface;
+	cb_info.code = perl_closure->callback;
+	cb_info.data = perl_closure->data;
+	cb_info.swap_data = GPERL_CLOSURE_SWAP_DATA (perl_closure);
+	cb_info.args_converter = signal_info->args_converter;
+#ifdef PERL_IMPLICIT_CONTEXT
+	/* Perl closures carry the interpreter they were created in as their
+	 * marshal data.  In an ithread cloned after the marshaller was set up,
+	 * the args converter is that interpreter's copy. */
+	cb_info.priv = marshal_data ? marshal_data : aTHX;
+	if (cb_info.args_converter && cb_info.priv != signal_info->priv)
+		cb_info.args_converter =
+			find_signal_args_converter (cb_info.priv, signal_info);
+#endif
 
-	c_closure.closure = *closure;
+	/* Convert the GValues into the form that ffi closures receive their
+	 * args in: an array of pointers to the values. */
+	values = g_newa (GIArgument, n_param_values);
+	raw_args = g_newa (gpointer, n_param_values);
+	values[0].v_pointer = g_value_peek_pointer (&param_values[0]);
+	raw_args[0] = &values[0];
+	for (i = 1; i < n_param_values; i++) {
+		gvalue_to_arg (&param_values[i], &values[i],
+		               &plan->base.arg_types[i-1]);
+		raw_args[i] = &values[i];
+	}
 
-#if GI_CHECK_VERSION (1, 72, 0)
-        c_closure.callback = g_callable_info_get_closure_native_address (signal_info->interface, cb_info->closure);
-#else
-	c_closure.callback = cb_info->closure;
-#endif
-	/* If marshal_data is non-NULL, gi_cclosure_marshal_generic uses it as
-	 * the callback.  Hence we pass NULL so that c_closure.callback is
-	 * used. */
-	gi_cclosure_marshal_generic ((GClosure *) &c_closure,
-	                             return_value,
-	                             n_param_values, param_values,
-	                             invocation_hint,
-	                             NULL /* instead of marshal_data */);
-
-	release_perl_callback (cb_info);
+	_invoke_perl_code (&cb_info, plan, raw_args, NULL, return_value);
 }
 
 #endif
 
 /* -------------------------------------------------------------------------- */
 
-static void
-_prepare_perl_invocation_info (GPerlI11nPerlInvocationInfo *iinfo,
-                               GICallableInfo *info,
-                               gpointer *args)
+static gboolean
+_is_by_value_arg (GITypeInfo *type_info)
+{
+	GITypeTag tag = g_type_info_get_tag (type_info);
+	switch (tag) {
+	    case GI_TYPE_TAG_VOID:
+		/* only user data is marshalled for void pointers */
+		return TRUE;
+	    case GI_TYPE_TAG_INTERFACE:
+	    {
+		GIBaseInfo *interface;
+		GIInfoType info_type;
+		if (g_type_info_is_pointer (type_info))
+			return FALSE;
+		interface = g_type_info_get_interface (type_info);
+		info_type = g_base_info_get_type (interface);
+		g_base_info_unref (interface);
+		return info_type == GI_INFO_TYPE_ENUM ||
+		       info_type == GI_INFO_TYPE_FLAGS;
+	    }
+	    default:
+		return G_TYPE_TAG_IS_BASIC (tag) &&
+		       tag != GI_TYPE_TAG_UTF8 &&
+		       tag != GI_TYPE_TAG_FILENAME;
+	}
+}
+
+static GPerlI11nPerlPlan *
+perl_plan_new (GICallableInfo *info)
 {
+	GPerlI11nPerlPlan *plan;
 	guint i;
 
-	prepare_invocation_info ((GPerlI11nInvocationInfo *) iinfo, info);
+	plan = g_new0 (GPerlI11nPerlPlan, 1);
+	plan_init ((GPerlI11nPlan *) plan, info);
 
-	dwarn ("%s, n_args = %d\n",
-	       g_base_info_get_name (info),
-	       g_callable_info_get_n_args (info));
+	dwarn ("%s, n_args = %u\n",
+	       g_base_info_get_name (info), plan->base.n_args);
 
 	/* When invoking Perl code, we currently always use a complete
 	 * description of the callable (from a record field or some callback
@@ -358,24 +460,103 @@ _prepare_perl_invocation_info (GPerlI11nPerlInvocationInfo *iinfo,
 
 	/* FIXME: 'throws'? */
 
-	/* Find array length arguments and store their value in aux_args so
-	 * that array_to_sv can later fetch them. */
-	for (i = 0 ; i < iinfo->base.n_args ; i++) {
-		GITypeInfo *arg_type = &(iinfo->base.arg_types[i]);
-		GITypeTag arg_tag = g_type_info_get_tag (arg_type);
+	if (plan->base.n_args) {
+		plan->directions = g_new0 (GIDirection, plan->base.n_args);
+		plan->transfers = g_new0 (GITransfer, plan->base.n_args);
+		plan->is_caller_allocated = g_new0 (gboolean, plan->base.n_args);
+		plan->length_arg_positions = g_new0 (guint, plan->base.n_args);
+	}
 
-		if (arg_tag == GI_TYPE_TAG_ARRAY) {
+	for (i = 0 ; i < plan->base.n_args ; i++) {
+		GIArgInfo *arg_info = &(plan->base.arg_infos[i]);
+		GITypeInfo *arg_type = &(plan->base.arg_types[i]);
+		GIDirection direction = g_arg_info_get_direction (arg_info);
+
+		plan->directions[i] = direction;
+		plan->transfers[i] = g_arg_info_get_ownership_transfer (arg_info);
+		plan->is_caller_allocated[i] =
+			g_arg_info_is_caller_allocates (arg_info);
+		if (direction == GI_DIRECTION_INOUT ||
+		    direction == GI_DIRECTION_OUT)
+		{
+			plan->n_in_inout++;
+		}
+
+		/* Remember array length arguments so that their value can be
+		 * stored in aux_args for array_to_sv. */
+		if (g_type_info_get_tag (arg_type) == GI_TYPE_TAG_ARRAY) {
 			gint pos = g_type_info_get_array_length (arg_type);
-			if (pos >= 0) {
-				GITypeInfo *length_arg_type;
-				guint args_pos = iinfo->base.is_signal ? pos+1 : pos;
-				length_arg_type = &(iinfo->base.arg_types[pos]);
-				raw_to_arg (args[args_pos], &iinfo->base.aux_args[pos], length_arg_type);
-				dwarn ("  pos %d is array length => %"G_GSIZE_FORMAT"\n",
-				       pos, iinfo->base.aux_args[pos].v_size);
-			}
+			if (pos >= 0)
+				plan->length_arg_positions[plan->n_length_args++] = (guint) pos;
+		}
+	}
+
+	/* determine suitable Perl call context */
+	plan->context = G_VOID | G_DISCARD;
+	if (plan->base.has_return_value) {
+		plan->context = plan->n_in_inout > 0
+		  ? G_ARRAY
+		  : G_SCALAR;
+	} else {
+		if (plan->n_in_inout == 1) {
+			plan->context = G_SCALAR;
+		} else if (plan->n_in_inout > 1) {
+			plan->context = G_ARRAY;
 		}
 	}
+	plan->n_return_values = plan->base.has_return_value
+	  ? plan->n_in_inout + 1
+	  : plan->n_in_inout;
+
+	plan->may_return_null = g_callable_info_may_return_null (info);
+
+	/* An invocation can outlive its caller if nothing is handed back and
+	 * all args are passed by value (or are the user data, which is our
+	 * own). */
+	plan->can_run_detached =
+		!plan->base.has_return_value && plan->n_in_inout == 0;
+	for (i = 0 ; i < plan->base.n_args && plan->can_run_detached ; i++) {
+		if (!_is_by_value_arg (&(plan->base.arg_types[i])))
+			plan->can_run_detached = FALSE;
+	}
+
+	return plan;
+}
+
+static void
+perl_plan_free (GPerlI11nPerlPlan *plan)
+{
+	g_free (plan->directions);
+	g_free (plan->transfers);
+	g_free (plan->is_caller_allocated);
+	g_free (plan->length_arg_positions);
+	if (plan->conversion)
+		args_conversion_free (plan->conversion);
+	plan_clear ((GPerlI11nPlan *) plan);
+	g_free (plan);
+}
+
+static void
+_prepare_perl_invocation_info (GPerlI11nPerlInvocationInfo *iinfo,
+                               const GPerlI11nPerlPlan *plan,
+                               gpointer *args)
+{
+	guint i;
+
+	prepare_invocation_info_from_plan ((GPerlI11nInvocationInfo *) iinfo,
+	                                   (const GPerlI11nPlan *) plan);
+	iinfo->plan = plan;
+
+	/* Store the values of array length arguments in aux_args so that
+	 * array_to_sv can later fetch them. */
+	for (i = 0 ; i < plan->n_length_args ; i++) {
+		guint pos = plan->length_arg_positions[i];
+		guint args_pos = plan->base.is_signal ? pos+1 : pos;
+		raw_to_arg (args[args_pos], &iinfo->base.aux_args[pos],
+		            &(iinfo->base.arg_types[pos]));
+		dwarn ("  pos %u is array length => %"G_GSIZE_FORMAT"\n",
+		       pos, iinfo->base.aux_args[pos].v_size);
+	}
 }
 
 static void
@@ -457,3 +638,149 @@ _fill_ffi_return_value (GITypeInfo *return_info,
 		break;
 	}
 }
+
+/* At most this many resolved subs are remembered per interpreter; the least
+ * recently used one is forgotten when another one comes along. */
+#define MAX_RESOLVED_METHODS 256
+
+/* The sub that a callback info's sub_name resolved to in a stash, together with
+ * the method cache generations at that time.  The entries are kept in MY_CXT,
+ * keyed by info and stash, so that they only ever refer to SVs of their own
+ * interpreter.  References to the stash and the sub are held. */
+typedef struct {
+	GPerlI11nPerlCallbackInfo *info;
+	HV *stash;
+	CV *cv;
+	U32 sub_generation;
+	U32 cache_generation;
+	GList link;
+} GPerlI11nResolvedMethod;
+
+static guint
+_resolved_method_hash (gconstpointer key)
+{
+	const GPerlI11nResolvedMethod *method = key;
+	return g_direct_hash (method->info) ^ g_direct_hash (method->stash);
+}
+
+static gboolean
+_resolved_method_equal (gconstpointer a, gconstpointer b)
+{
+	const GPerlI11nResolvedMethod *method_a = a, *method_b = b;
+	return method_a->info == method_b->info &&
+	       method_a->stash == method_b->stash;
+}
+
+static GHashTable *
+new_resolved_methods_table (void)
+{
+	return g_hash_table_new (_resolved_method_hash, _resolved_method_equal);
+}
+
+/* Removes method from the table and the LRU queue it is in, and frees it. */
+static void
+_remove_resolved_method (GHashTable *table, GQueue *lru,
+                         GPerlI11nResolvedMethod *method)
+{
+	g_hash_table_remove (table, method);
+	g_queue_unlink (lru, &method->link);
+	SvREFCNT_dec ((SV *) method->cv);
+	SvREFCNT_dec ((SV *) method->stash);
+	g_free (method);
+}
+
+/* Forgets the subs resolved for info, or all of them if info is NULL.  Only
+ * affects the current interpreter. */
+static void
+clear_resolved_methods (GPerlI11nPerlCallbackInfo *info)
+{
+	GList *l, *next;
+
+	/* Only infos with a sub name ever get resolved. */
+	if (info && !info->sub_name)
+		return;
+
+	{
+		dMY_CXT;
+		if (!MY_CXT.resolved_methods)
+			return;
+		for (l = MY_CXT.resolved_methods_lru.head; l != NULL; l = next) {
+			GPerlI11nResolvedMethod *method = l->data;
+			next = l->next;
+			if (!info || method->info == info)
+				_remove_resolved_method (MY_CXT.resolved_methods,
+				                         &MY_CXT.resolved_methods_lru,
+				                         method);
+		}
+	}
+}
+
+/* Look up the sub that info->sub_name refers to for the invocant on the stack,
+ * reusing the result of an earlier lookup for the invocant's class if perl's
+ * method caches have not changed since.  Since vfunc closures are shared by
+ * all implementing classes, the results are kept per info and class.  Returns
+ * NULL if the caller should fall back to call_method, e.g. because the method
+ * would be autoloaded. */
+static CV *
+_resolve_method (GPerlI11nPerlCallbackInfo *info)
+{
+#ifdef HvMROMETA
+	SV *invocant;
+	HV *stash;
+	GV *gv;
+	GPerlI11nResolvedMethod lookup, *method;
+	dMY_CXT;
+
+	/* Nothing is cached anymore while the interpreter is shut down. */
+	if (!MY_CXT.resolved_methods)
+		return NULL;
+
+	/* The invocant is the first argument above the topmost mark. */
+	if (PL_stack_sp - (PL_stack_base + TOPMARK) < 1)
+		return NULL;
+	invocant = *(PL_stack_base + TOPMARK + 1);
+	if (!invocant || !SvROK (invocant) || !SvOBJECT (SvRV (invocant)))
+		return NULL;
+	stash = SvSTASH (SvRV (invocant));
+
+	lookup.info = info;
+	lookup.stash = stash;
+	method = g_hash_table_lookup (MY_CXT.resolved_methods, &lookup);
+	if (method &&
+	    method->sub_generation == PL_sub_generation &&
+	    method->cache_generation == HvMROMETA (stash)->cache_gen)
+	{
+		g_queue_unlink (&MY_CXT.resolved_methods_lru, &method->link);
+		g_queue_push_head_link (&MY_CXT.resolved_methods_lru,
+		                        &method->link);
+		return method->cv;
+	}
+	if (method)
+		_remove_resolved_method (MY_CXT.resolved_methods,
+		                         &MY_CXT.resolved_methods_lru,
+		                         method);
+
+	gv = gv_fetchmethod_autoload (stash, info->sub_name, FALSE);
+	if (!gv || !isGV (gv) || !GvCV (gv))
+		return NULL;
+
+	dwarn ("resolved %s::%s\n", HvNAME (stash), info->sub_name);
+	if (MY_CXT.resolved_methods_lru.length >= MAX_RESOLVED_METHODS)
+		_remove_resolved_method (MY_CXT.resolved_methods,
+		                         &MY_CXT.resolved_methods_lru,
+		                         MY_CXT.resolved_methods_lru.tail->data);
+	method = g_new0 (GPerlI11nResolvedMethod, 1);
+	method->info = info;
+	method->stash = (HV *) SvREFCNT_inc ((SV *) stash);
+	method->cv = (CV *) SvREFCNT_inc ((SV *) GvCV (gv));
+	method->sub_generation = PL_sub_generation;
+	method->cache_generation = HvMROMETA (stash)->cache_gen;
+	method->link.data = method;
+	g_hash_table_insert (MY_CXT.resolved_methods, method, method);
+	g_queue_push_head_link (&MY_CXT.resolved_methods_lru, &method->link);
+	return method->cv;
+#else
+	PERL_UNUSED_VAR (info);
+	return NULL;
+#endif
+}
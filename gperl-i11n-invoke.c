@@ -1,53 +1,86 @@
 /* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
 
+/* Fill in the parts of a plan that are common to C and Perl invocations.  The
+ * plan takes a reference on the callable. */
 static void
-prepare_invocation_info (GPerlI11nInvocationInfo *iinfo,
-                         GICallableInfo *info)
+plan_init (GPerlI11nPlan *plan, GICallableInfo *info)
 {
 	gint orig_n_args;
 	guint i;
 
-	dwarn ("%s\n", g_base_info_get_name (info));
+	plan->interface = g_base_info_ref (info);
 
-	iinfo->interface = info;
-
-	iinfo->is_function = GI_IS_FUNCTION_INFO (info);
-	iinfo->is_vfunc = GI_IS_VFUNC_INFO (info);
-	iinfo->is_callback = (g_base_info_get_type (info) == GI_INFO_TYPE_CALLBACK);
-	iinfo->is_signal = GI_IS_SIGNAL_INFO (info);
-	dwarn ("  is_function = %d, is_vfunc = %d, is_callback = %d\n",
-	       iinfo->is_function, iinfo->is_vfunc, iinfo->is_callback);
+	plan->is_function = GI_IS_FUNCTION_INFO (info);
+	plan->is_vfunc = GI_IS_VFUNC_INFO (info);
+	plan->is_callback = (g_base_info_get_type (info) == GI_INFO_TYPE_CALLBACK);
+	plan->is_signal = GI_IS_SIGNAL_INFO (info);
 
 	orig_n_args = g_callable_info_get_n_args (info);
 	g_assert (orig_n_args >= 0);
-	iinfo->n_args = (guint) orig_n_args;
-	dwarn ("  n_args = %u\n", iinfo->n_args);
+	plan->n_args = (guint) orig_n_args;
 
-	if (iinfo->n_args) {
-		iinfo->arg_infos = gperl_alloc_temp (sizeof (GITypeInfo) * iinfo->n_args);
-		iinfo->arg_types = gperl_alloc_temp (sizeof (GITypeInfo) * iinfo->n_args);
-		iinfo->aux_args = gperl_alloc_temp (sizeof (GIArgument) * iinfo->n_args);
+	if (plan->n_args) {
+		plan->arg_infos = g_new0 (GIArgInfo, plan->n_args);
+		plan->arg_types = g_new0 (GITypeInfo, plan->n_args);
 	} else {
-		iinfo->arg_infos = NULL;
-		iinfo->arg_types = NULL;
-		iinfo->aux_args = NULL;
+		plan->arg_infos = NULL;
+		plan->arg_types = NULL;
 	}
 
-	for (i = 0 ; i < iinfo->n_args ; i++) {
-		g_callable_info_load_arg (info, (gint) i, &(iinfo->arg_infos[i]));
-		g_arg_info_load_type (&(iinfo->arg_infos[i]), &(iinfo->arg_types[i]));
+	for (i = 0 ; i < plan->n_args ; i++) {
+		g_callable_info_load_arg (info, (gint) i, &(plan->arg_infos[i]));
+		g_arg_info_load_type (&(plan->arg_infos[i]), &(plan->arg_types[i]));
 	}
 
-	g_callable_info_load_return_type (info, &iinfo->return_type_info);
-	iinfo->has_return_value =
-		GI_TYPE_TAG_VOID != g_type_info_get_tag (&iinfo->return_type_info);
-	iinfo->return_type_ffi = g_type_info_get_ffi_type (&iinfo->return_type_info);
-	iinfo->return_type_transfer = g_callable_info_get_caller_owns (info);
+	g_callable_info_load_return_type (info, &plan->return_type_info);
+	plan->has_return_value =
+		GI_TYPE_TAG_VOID != g_type_info_get_tag (&plan->return_type_info);
+	plan->return_type_ffi = g_type_info_get_ffi_type (&plan->return_type_info);
+	plan->return_type_transfer = g_callable_info_get_caller_owns (info);
+}
+
+static void
+plan_clear (GPerlI11nPlan *plan)
+{
+	g_free (plan->arg_infos);
+	g_free (plan->arg_types);
+	g_base_info_unref (plan->interface);
+}
+
+/* Set up the per-invocation parts of iinfo for the given plan.  The arg info
+ * arrays are shared with the plan and must not be modified. */
+static void
+prepare_invocation_info_from_plan (GPerlI11nInvocationInfo *iinfo,
+                                   const GPerlI11nPlan *plan)
+{
+	dwarn ("%s\n", g_base_info_get_name (plan->interface));
+
+	iinfo->interface = plan->interface;
+
+	iinfo->is_function = plan->is_function;
+	iinfo->is_vfunc = plan->is_vfunc;
+	iinfo->is_callback = plan->is_callback;
+	iinfo->is_signal = plan->is_signal;
+
+	iinfo->n_args = plan->n_args;
+	iinfo->current_arg_is_omitted = FALSE;
+	iinfo->arg_infos = plan->arg_infos;
+	iinfo->arg_types = plan->arg_types;
+	iinfo->aux_args = iinfo->n_args
+		? gperl_alloc_temp (sizeof (GIArgument) * iinfo->n_args)
+		: NULL;
+
+	iinfo->return_type_info = plan->return_type_info;
+	iinfo->has_return_value = plan->has_return_value;
+	iinfo->return_type_ffi = plan->return_type_ffi;
+	iinfo->return_type_transfer = plan->return_type_transfer;
 
 	iinfo->callback_infos = NULL;
 	iinfo->array_infos = NULL;
 
 	iinfo->free_after_call = NULL;
+
+	iinfo->future = NULL;
 }
 
 static void
@@ -71,6 +104,11 @@ clear_invocation_info (GPerlI11nInvocationInfo *iinfo)
 	g_slist_foreach (iinfo->array_infos, _free_array_info, NULL);
 	g_slist_free (iinfo->array_infos);
 	iinfo->array_infos = NULL;
+
+	if (iinfo->future) {
+		SvREFCNT_dec (iinfo->future);
+		iinfo->future = NULL;
+	}
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1,5 +1,95 @@
 /* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
 
+/* For an *_async function, finds the matching *_finish function by the naming
+ * convention.  Returns NULL if there is none or if it takes anything but the
+ * source object and the result. */
+static const GPerlI11nFunctionEntry *
+find_finish_function (GICallableInfo *async_info,
+                       GIBaseInfo *callback_interface_info)
+{
+	const gchar *name, *basename, *namespace = NULL;
+	GIBaseInfo *container, *finish_info;
+	const GPerlI11nFunctionEntry *entry = NULL;
+	gchar *finish_name;
+	gsize length;
+
+	if (!GI_IS_FUNCTION_INFO (async_info) ||
+	    strcmp (g_base_info_get_namespace (callback_interface_info), "Gio") ||
+	    strcmp (g_base_info_get_name (callback_interface_info), "AsyncReadyCallback"))
+		return NULL;
+	name = g_base_info_get_name (async_info);
+	if (!g_str_has_suffix (name, "_async"))
+		return NULL;
+
+	length = strlen (name) - strlen ("_async");
+	finish_name = g_strdup_printf ("%.*s_finish", (int) length, name);
+	basename = g_base_info_get_namespace (async_info);
+	container = g_base_info_get_container (async_info);
+	if (container && GI_IS_REGISTERED_TYPE_INFO (container)) {
+		namespace = g_base_info_get_name (container);
+		finish_info = find_member (container, GPERL_I11N_MEMBER_METHOD,
+		                           finish_name);
+	} else {
+		finish_info = g_irepository_find_by_name (g_irepository_get_default (),
+		                                          basename, finish_name);
+	}
+	if (finish_info) {
+		if (GI_IS_FUNCTION_INFO (finish_info))
+			entry = get_cached_function_entry (basename, namespace,
+			                                   finish_name);
+		g_base_info_unref (finish_info);
+	}
+	g_free (finish_name);
+
+	if (entry &&
+	    (entry->plan->takes_callback ||
+	     entry->plan->n_expected_args != (entry->plan->is_method ? 2u : 1u)))
+		entry = NULL;
+	return entry;
+}
+
+static void
+_invoke_finish_callback (GObject *source_object, GObject *res, gpointer user_data)
+{
+	GPerlI11nPerlCallbackInfo *info = user_data;
+	dGPERL_CALLBACK_MARSHAL_SP;
+	GPERL_CALLBACK_MARSHAL_INIT (info);
+	PERL_UNUSED_VAR (sp);
+	if (info->bulk)
+		complete_async_bulk_op (info->bulk, info->bulk_index,
+		                        info->finish, source_object, res);
+	else
+		invoke_finish_into_future (info->finish, source_object, res,
+		                           info->future);
+	/* No ffi closure is involved, so the info can be released right
+	 * away. */
+	release_perl_callback (info);
+}
+
+/* Sets up a native GAsyncReadyCallback that resolves a future which is
+ * returned from the call. */
+static GPerlI11nPerlCallbackInfo *
+_create_finish_callback (const GPerlI11nFunctionEntry *finish,
+                         GPerlI11nInvocationInfo *invocation_info)
+{
+	GPerlI11nPerlCallbackInfo *info;
+
+	info = g_new0 (GPerlI11nPerlCallbackInfo, 1);
+	info->finish = finish;
+	info->future = new_future ();
+	info->data_pos = -1;
+	info->destroy_pos = -1;
+#ifdef PERL_IMPLICIT_CONTEXT
+	info->priv = aTHX;
+#endif
+
+	if (invocation_info->future)
+		SvREFCNT_dec (invocation_info->future);
+	invocation_info->future = SvREFCNT_inc (info->future);
+
+	return info;
+}
+
 static gpointer
 sv_to_callback (GIArgInfo * arg_info,
                 GITypeInfo * type_info,
@@ -8,6 +98,7 @@ sv_to_callback (GIArgInfo * arg_info,
 {
 	GIBaseInfo *callback_interface_info;
 	GPerlI11nPerlCallbackInfo *callback_info;
+	GPerlI11nNativeCallable native;
 	GIScopeType scope;
 
 	/* the destroy notify func is handled by _handle_automatic_arg */
@@ -17,7 +108,68 @@ sv_to_callback (GIArgInfo * arg_info,
 	       g_base_info_get_name (arg_info));
 
 	callback_interface_info = g_type_info_get_interface (type_info);
-	callback_info = create_perl_callback_closure (callback_interface_info, sv);
+
+	/* An *_async function called without a callback returns a future
+	 * instead.  An explicit undef still means that nobody is notified. */
+	if (invocation_info->current_arg_is_omitted &&
+	    invocation_info->is_function &&
+	    g_arg_info_get_scope (arg_info) == GI_SCOPE_TYPE_ASYNC)
+	{
+		const GPerlI11nFunctionEntry *finish =
+			find_finish_function (invocation_info->interface,
+			                       callback_interface_info);
+		if (finish) {
+			callback_info = _create_finish_callback (finish,
+			                                         invocation_info);
+			callback_info->data_pos = g_arg_info_get_closure (arg_info);
+			g_base_info_unref (callback_interface_info);
+			invocation_info->callback_infos =
+				g_slist_prepend (invocation_info->callback_infos,
+				                 callback_info);
+			dwarn ("  -> future %p\n", callback_info->future);
+			return (gpointer) _invoke_finish_callback;
+		}
+	}
+
+	scope = (!gperl_sv_is_defined (sv))
+		? GI_SCOPE_TYPE_CALL
+		: g_arg_info_get_scope (arg_info);
+
+	/* A native handler needs no closure; only its pointers are handed
+	 * on. */
+	if (native_callable_from_sv (sv, &native)) {
+		gboolean matches = native_signature_matches (
+			&native, callback_interface_info, FALSE,
+			G_TYPE_NONE, G_TYPE_NONE);
+		g_base_info_unref (callback_interface_info);
+		if (!matches)
+			ccroak ("%s does not match the signature of %s",
+			        g_base_info_get_name (native.info),
+			        g_base_info_get_name (arg_info));
+		callback_info = create_native_callback_info (&native, scope);
+		callback_info->data_pos = g_arg_info_get_closure (arg_info);
+		callback_info->destroy_pos = g_arg_info_get_destroy (arg_info);
+		free_after_call (invocation_info,
+		                 release_perl_callback, callback_info);
+		invocation_info->callback_infos =
+			g_slist_prepend (invocation_info->callback_infos,
+			                 callback_info);
+		dwarn ("  -> native function %p\n", native.func);
+		return native.func;
+	}
+
+	if (is_coalesced_sv (sv) && callable_has_results (callback_interface_info)) {
+		g_base_info_unref (callback_interface_info);
+		ccroak ("%s returns values and thus cannot be coalesced",
+		        g_base_info_get_name (arg_info));
+	}
+
+	/* Sort keys can only be kept if the callback does not outlive the
+	 * call. */
+	callback_info = is_comparator_sv (sv)
+		? create_native_comparator_closure (callback_interface_info, sv,
+		                                    scope == GI_SCOPE_TYPE_CALL)
+		: create_perl_callback_closure (callback_interface_info, sv);
 	callback_info->data_pos = g_arg_info_get_closure (arg_info);
 	callback_info->destroy_pos = g_arg_info_get_destroy (arg_info);
 	callback_info->free_after_use = FALSE;
@@ -25,10 +177,6 @@ sv_to_callback (GIArgInfo * arg_info,
 
 	dwarn ("  data at %d, destroy at %d\n",
 	       callback_info->data_pos, callback_info->destroy_pos);
-
-	scope = (!gperl_sv_is_defined (sv))
-		? GI_SCOPE_TYPE_CALL
-		: g_arg_info_get_scope (arg_info);
 	switch (scope) {
 	    case GI_SCOPE_TYPE_CALL:
 		dwarn ("  scope = 'call'\n");
@@ -42,7 +190,7 @@ sv_to_callback (GIArgInfo * arg_info,
 		break;
 	    case GI_SCOPE_TYPE_ASYNC:
 		dwarn ("  scope = 'async'\n");
-		/* FIXME: callback_info->free_after_use = TRUE; */
+		register_async_perl_callback (callback_info);
 		break;
 	    default:
 		ccroak ("unhandled scope type %d encountered",
@@ -79,6 +227,10 @@ sv_to_callback_data (SV * sv,
 		if (callback_info->data_pos == ((gint) invocation_info->current_pos)) {
 			dwarn ("user data for Perl callback %p\n",
 			       callback_info);
+			/* A native handler keeps the user data it came with;
+			 * Perl data cannot be handed to it. */
+			if (callback_info->native_func)
+				return callback_info->native_data;
 			attach_perl_callback_data (callback_info, sv);
 			/* If the user did not specify any code and data and if
 			 * there is no destroy notify function, then there is
@@ -88,6 +240,7 @@ sv_to_callback_data (SV * sv,
 			 * function pointer is NULL. */
 			if (!gperl_sv_is_defined (callback_info->code) &&
 			    !gperl_sv_is_defined (callback_info->data) &&
+			    !callback_info->future &&
 			    -1 == callback_info->destroy_pos)
 			{
 				dwarn ("  -> handing over NULL");
@@ -159,3 +159,147 @@ arg_to_raw (GIArgument *arg, gpointer raw, GITypeInfo *info)
 		ccroak ("Unhandled info tag %d in arg_to_raw", tag);
 	}
 }
+
+/* Stores an integer that came out of a GValue in arg, in the slot that
+ * raw_to_arg would use for the typelib type. */
+static void
+_store_integer (GIArgument *arg, GITypeInfo *info, gint64 value)
+{
+	GITypeTag tag = g_type_info_get_tag (info);
+
+	switch (tag) {
+	    case GI_TYPE_TAG_BOOLEAN:
+		arg->v_boolean = (gboolean) value;
+		break;
+
+	    case GI_TYPE_TAG_INT8:
+		arg->v_int8 = (gint8) value;
+		break;
+
+	    case GI_TYPE_TAG_UINT8:
+		arg->v_uint8 = (guint8) value;
+		break;
+
+	    case GI_TYPE_TAG_INT16:
+		arg->v_int16 = (gint16) value;
+		break;
+
+	    case GI_TYPE_TAG_UINT16:
+		arg->v_uint16 = (guint16) value;
+		break;
+
+	    case GI_TYPE_TAG_INT32:
+		arg->v_int32 = (gint32) value;
+		break;
+
+	    case GI_TYPE_TAG_UINT32:
+	    case GI_TYPE_TAG_UNICHAR:
+		arg->v_uint32 = (guint32) value;
+		break;
+
+	    case GI_TYPE_TAG_INT64:
+		arg->v_int64 = value;
+		break;
+
+	    case GI_TYPE_TAG_UINT64:
+		arg->v_uint64 = (guint64) value;
+		break;
+
+	    case GI_TYPE_TAG_GTYPE:
+		arg->v_size = (gsize) value;
+		break;
+
+	    default:
+		ccroak ("Unhandled info tag %d for integer in gvalue_to_arg",
+		        tag);
+	}
+}
+
+/* Fills arg from a GValue, as handed to signal marshallers, so that passing
+ * &arg to raw_to_arg yields the value.  The GValue's type tells where the
+ * value lives; the typelib type tells how it is to be stored. */
+static void
+gvalue_to_arg (const GValue *value, GIArgument *arg, GITypeInfo *info)
+{
+	GType type = G_VALUE_TYPE (value);
+
+	memset (arg, 0, sizeof (GIArgument));
+
+	if (G_VALUE_HOLDS_GTYPE (value)) {
+		arg->v_size = g_value_get_gtype (value);
+		return;
+	}
+
+	switch (G_TYPE_FUNDAMENTAL (type)) {
+	    case G_TYPE_BOOLEAN:
+		arg->v_boolean = g_value_get_boolean (value);
+		break;
+
+	    case G_TYPE_CHAR:
+		_store_integer (arg, info, g_value_get_schar (value));
+		break;
+
+	    case G_TYPE_UCHAR:
+		_store_integer (arg, info, g_value_get_uchar (value));
+		break;
+
+	    case G_TYPE_INT:
+		_store_integer (arg, info, g_value_get_int (value));
+		break;
+
+	    case G_TYPE_UINT:
+		_store_integer (arg, info, g_value_get_uint (value));
+		break;
+
+	    case G_TYPE_LONG:
+		_store_integer (arg, info, g_value_get_long (value));
+		break;
+
+	    case G_TYPE_ULONG:
+		_store_integer (arg, info, (gint64) g_value_get_ulong (value));
+		break;
+
+	    case G_TYPE_INT64:
+		_store_integer (arg, info, g_value_get_int64 (value));
+		break;
+
+	    case G_TYPE_UINT64:
+		_store_integer (arg, info, (gint64) g_value_get_uint64 (value));
+		break;
+
+	    case G_TYPE_FLOAT:
+		arg->v_float = g_value_get_float (value);
+		break;
+
+	    case G_TYPE_DOUBLE:
+		arg->v_double = g_value_get_double (value);
+		break;
+
+	    case G_TYPE_ENUM:
+	    case G_TYPE_FLAGS:
+	    {
+		GIBaseInfo *interface;
+		gint v = G_TYPE_FUNDAMENTAL (type) == G_TYPE_ENUM
+			? g_value_get_enum (value)
+			: (gint) g_value_get_flags (value);
+		if (g_type_info_get_tag (info) != GI_TYPE_TAG_INTERFACE) {
+			_store_integer (arg, info, v);
+			break;
+		}
+		interface = g_type_info_get_interface (info);
+		_store_enum (interface, v, arg);
+		g_base_info_unref (interface);
+		break;
+	    }
+
+	    case G_TYPE_STRING:
+		arg->v_string = (gchar *) g_value_get_string (value);
+		break;
+
+	    default:
+		if (!g_value_fits_pointer (value))
+			ccroak ("Cannot convert GValue of type %s",
+			        g_type_name (type));
+		arg->v_pointer = g_value_peek_pointer (value);
+	}
+}
@@ -0,0 +1,369 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+/* Native handlers: wherever a callback or signal handler is expected, a C
+ * function can be passed instead of Perl code -- either a function from a
+ * typelib, wrapped in a Glib::Object::Introspection::NativeFunction, or a C
+ * callback that was handed to Perl earlier.  Its function pointer is then
+ * wired in directly, after checking that its signature fits. */
+
+#define NATIVE_FUNCTION_PACKAGE "Glib::Object::Introspection::NativeFunction"
+#define FUNC_WRAPPER_PACKAGE "Glib::Object::Introspection::_FuncWrapper"
+
+typedef struct {
+	ffi_type *ffi;
+	GITypeTag tag;
+	/* for interface args, and for the instance and user data slots of
+	 * signals: the type of the values, if it is registered */
+	GType gtype;
+	GIBaseInfo *interface;
+} GPerlI11nNativeArg;
+
+/* Fills native with borrowed references if sv is a native handle. */
+static gboolean
+native_callable_from_sv (SV *sv, GPerlI11nNativeCallable *native)
+{
+	if (!sv || !SvROK (sv) || !SvOBJECT (SvRV (sv)))
+		return FALSE;
+
+	if (sv_derived_from (sv, NATIVE_FUNCTION_PACKAGE)) {
+		HV *hv = (HV *) SvRV (sv);
+		SV **basename = hv_fetchs (hv, "basename", 0);
+		SV **namespace = hv_fetchs (hv, "namespace", 0);
+		SV **function = hv_fetchs (hv, "function", 0);
+		const GPerlI11nFunctionEntry *entry;
+		if (!basename || !function)
+			ccroak ("Malformed %s encountered", NATIVE_FUNCTION_PACKAGE);
+		entry = get_cached_function_entry (
+			SvPV_nolen (*basename),
+			namespace && gperl_sv_is_defined (*namespace)
+				? SvPV_nolen (*namespace) : NULL,
+			SvPV_nolen (*function));
+		native->info = entry->info;
+		native->is_method = (g_function_info_get_flags (entry->info) &
+		                     GI_FUNCTION_IS_METHOD) != 0;
+		native->func = entry->func_pointer;
+		native->wrapper = NULL;
+		return TRUE;
+	}
+
+	if (sv_derived_from (sv, FUNC_WRAPPER_PACKAGE)) {
+		GPerlI11nCCallbackInfo *wrapper =
+			INT2PTR (GPerlI11nCCallbackInfo *, SvIV (SvRV (sv)));
+		if (!wrapper || !wrapper->func)
+			ccroak ("invalid reference encountered");
+		native->info = wrapper->interface;
+		native->is_method = FALSE;
+		native->func = wrapper->func;
+		native->wrapper = wrapper;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static GType
+_get_native_gtype (GIBaseInfo *info)
+{
+	GType gtype = info && GI_IS_REGISTERED_TYPE_INFO (info)
+		? get_gtype ((GIRegisteredTypeInfo *) info)
+		: G_TYPE_NONE;
+	return gtype ? gtype : G_TYPE_NONE;
+}
+
+static void
+_load_native_arg_type (GITypeInfo *type_info, GPerlI11nNativeArg *arg)
+{
+	arg->tag = g_type_info_get_tag (type_info);
+	arg->gtype = G_TYPE_NONE;
+	arg->interface = NULL;
+	if (arg->tag == GI_TYPE_TAG_INTERFACE) {
+		arg->interface = g_type_info_get_interface (type_info);
+		arg->gtype = _get_native_gtype (arg->interface);
+	}
+}
+
+static void
+_load_native_arg (GIArgInfo *arg_info, GPerlI11nNativeArg *arg)
+{
+	GITypeInfo type_info;
+	g_arg_info_load_type (arg_info, &type_info);
+	_load_native_arg_type (&type_info, arg);
+	/* out and in-out args are passed as pointers to the values */
+	arg->ffi = g_arg_info_get_direction (arg_info) == GI_DIRECTION_IN
+		? g_type_info_get_ffi_type (&type_info)
+		: &ffi_type_pointer;
+}
+
+static void
+_load_native_return (GICallableInfo *info, GPerlI11nNativeArg *arg)
+{
+	GITypeInfo type_info;
+	g_callable_info_load_return_type (info, &type_info);
+	_load_native_arg_type (&type_info, arg);
+	arg->ffi = g_type_info_get_ffi_type (&type_info);
+}
+
+/* A pointer slot that is not described by an arg, like an instance or user
+ * data; gtype is the type of the object it holds, if known. */
+static void
+_load_native_pointer (GType gtype, GPerlI11nNativeArg *arg)
+{
+	arg->ffi = &ffi_type_pointer;
+	arg->tag = gtype != G_TYPE_NONE
+		? GI_TYPE_TAG_INTERFACE : GI_TYPE_TAG_VOID;
+	arg->gtype = gtype;
+	arg->interface = NULL;
+}
+
+static void
+_clear_native_arg (GPerlI11nNativeArg *arg)
+{
+	if (arg->interface)
+		g_base_info_unref (arg->interface);
+	arg->interface = NULL;
+}
+
+/* Describes the C args of info.  If has_instance, the first one is an instance
+ * of instance_type; if has_user_data, the last one holds an object of
+ * user_data_type, or NULL.  The caller owns the return value; free it with
+ * _free_native_args. */
+static GPerlI11nNativeArg *
+_get_native_args (GICallableInfo *info,
+                  gboolean has_instance,
+                  GType instance_type,
+                  gboolean has_user_data,
+                  GType user_data_type,
+                  gint *n_args)
+{
+	GPerlI11nNativeArg *args;
+	GIArgInfo arg_info;
+	gint n, i, j = 0;
+
+	n = g_callable_info_get_n_args (info);
+	args = g_new0 (GPerlI11nNativeArg, n + 3);
+	if (has_instance)
+		_load_native_pointer (instance_type, &args[j++]);
+	for (i = 0; i < n; i++) {
+		g_callable_info_load_arg (info, i, &arg_info);
+		_load_native_arg (&arg_info, &args[j++]);
+	}
+	if (g_callable_info_can_throw_gerror (info)) {
+		args[j].ffi = &ffi_type_pointer;
+		args[j++].tag = GI_TYPE_TAG_ERROR;
+	}
+	if (has_user_data)
+		_load_native_pointer (user_data_type, &args[j++]);
+	*n_args = j;
+	return args;
+}
+
+static void
+_free_native_args (GPerlI11nNativeArg *args, gint n_args)
+{
+	gint i;
+	for (i = 0; i < n_args; i++)
+		_clear_native_arg (&args[i]);
+	g_free (args);
+}
+
+/* Whether a slot of type accepting can be handed values of type given. */
+static gboolean
+_native_arg_accepts (const GPerlI11nNativeArg *accepting,
+                     const GPerlI11nNativeArg *given)
+{
+	if (accepting->ffi != given->ffi)
+		return FALSE;
+	/* a GError location must not be confused with user data */
+	if (accepting->tag == GI_TYPE_TAG_ERROR ||
+	    given->tag == GI_TYPE_TAG_ERROR)
+		return accepting->tag == given->tag;
+	/* an untyped pointer takes all pointers, but not the other way
+	 * around */
+	if (accepting->ffi == &ffi_type_pointer &&
+	    accepting->tag == GI_TYPE_TAG_VOID)
+		return TRUE;
+	if (accepting->tag != given->tag)
+		return FALSE;
+	if (accepting->tag != GI_TYPE_TAG_INTERFACE)
+		return TRUE;
+	if (accepting->gtype != G_TYPE_NONE && given->gtype != G_TYPE_NONE)
+		return g_type_is_a (given->gtype, accepting->gtype);
+	return accepting->interface && given->interface &&
+	       g_base_info_equal (accepting->interface, given->interface);
+}
+
+/* Checks that native can be called where a function of the form described by
+ * expected is called.  As usual in C, native may ignore trailing args.  For
+ * signals, the first and last args of expected hold objects of the given
+ * types; the last one may be NULL. */
+static gboolean
+native_signature_matches (const GPerlI11nNativeCallable *native,
+                          GICallableInfo *expected,
+                          gboolean expected_is_signal,
+                          GType first_type,
+                          GType last_type)
+{
+	GPerlI11nNativeArg *native_args, *expected_args;
+	GPerlI11nNativeArg native_return, expected_return;
+	GType native_instance_type = G_TYPE_NONE;
+	gint n_native_args, n_expected_args, i;
+	gboolean matches;
+
+	if (native->is_method)
+		native_instance_type = _get_native_gtype (
+			g_base_info_get_container (native->info));
+	native_args = _get_native_args (native->info,
+	                                native->is_method, native_instance_type,
+	                                FALSE, G_TYPE_NONE,
+	                                &n_native_args);
+	expected_args = _get_native_args (expected,
+	                                  expected_is_signal, first_type,
+	                                  expected_is_signal, last_type,
+	                                  &n_expected_args);
+	matches = n_native_args <= n_expected_args;
+	for (i = 0; matches && i < n_native_args; i++)
+		matches = _native_arg_accepts (&native_args[i],
+		                               &expected_args[i]);
+	_free_native_args (native_args, n_native_args);
+	_free_native_args (expected_args, n_expected_args);
+
+	/* a return value may be ignored, but not made up */
+	_load_native_return (expected, &expected_return);
+	if (matches && expected_return.ffi != &ffi_type_void) {
+		_load_native_return (native->info, &native_return);
+		matches = _native_arg_accepts (&expected_return,
+		                               &native_return);
+		_clear_native_arg (&native_return);
+	}
+	_clear_native_arg (&expected_return);
+
+	return matches;
+}
+
+/* Creates a callback info that hands native's function pointer and user data
+ * to C.  It is released with release_perl_callback like all others. */
+static GPerlI11nPerlCallbackInfo *
+create_native_callback_info (const GPerlI11nNativeCallable *native,
+                             GIScopeType scope)
+{
+	GPerlI11nPerlCallbackInfo *info;
+
+	/* The data of a C callback has to live as long as the callee keeps the
+	 * function.  We can only see to that if we own the data and the
+	 * callee tells us when it is done with it. */
+	if (native->wrapper && native->wrapper->data &&
+	    scope != GI_SCOPE_TYPE_CALL)
+	{
+		if (!native->wrapper->destroy)
+			ccroak ("The data of %s is only valid during the call "
+			        "that handed it out, so it cannot be kept",
+			        g_base_info_get_name (native->info));
+		if (scope != GI_SCOPE_TYPE_NOTIFIED)
+			ccroak ("%s can only be kept by callees that take a "
+			        "destroy notify for it",
+			        g_base_info_get_name (native->info));
+	}
+
+	info = g_new0 (GPerlI11nPerlCallbackInfo, 1);
+	info->native_func = native->func;
+	info->data_pos = -1;
+	info->destroy_pos = -1;
+	if (native->wrapper) {
+		info->native_data = native->wrapper->data;
+		/* with a destroy notify, the callee takes over the data */
+		if (scope == GI_SCOPE_TYPE_NOTIFIED) {
+			info->native_destroy = native->wrapper->destroy;
+			native->wrapper->destroy = NULL;
+		}
+	}
+#ifdef PERL_IMPLICIT_CONTEXT
+	info->priv = aTHX;
+#endif
+
+	return info;
+}
+
+static void
+_unref_native_handler_data (gpointer data, GClosure *closure)
+{
+	PERL_UNUSED_VAR (closure);
+	g_object_unref (data);
+}
+
+/* Connects native to the signal.  If data is given, it is referenced for as
+ * long as the handler is connected.  C callbacks bring their own user data
+ * instead, which the handler then takes over. */
+static gulong
+connect_native_signal_handler (GObject *instance,
+                               const gchar *detailed_signal,
+                               GPerlI11nNativeCallable *native,
+                               GObject *data,
+                               gboolean swapped,
+                               gboolean after)
+{
+	guint signal_id;
+	GQuark detail;
+	GSignalQuery query;
+	GIBaseInfo *container_info;
+	GISignalInfo *signal_info;
+	GClosure *closure;
+	gpointer closure_data = data;
+	GClosureNotify closure_notify = data ? _unref_native_handler_data : NULL;
+	GType data_type = data ? G_OBJECT_TYPE (data) : G_TYPE_NONE;
+
+	if (native->wrapper && native->wrapper->data) {
+		if (data)
+			ccroak ("%s brings its own user data, so no data can "
+			        "be given for it",
+			        g_base_info_get_name (native->info));
+		if (!native->wrapper->destroy)
+			ccroak ("The data of %s is only valid during the call "
+			        "that handed it out, so it cannot be kept",
+			        g_base_info_get_name (native->info));
+		closure_data = native->wrapper->data;
+		closure_notify = (GClosureNotify) native->wrapper->destroy;
+	}
+
+	if (!g_signal_parse_name (detailed_signal, G_OBJECT_TYPE (instance),
+	                          &signal_id, &detail, TRUE))
+		ccroak ("Unknown signal %s for object of type %s",
+		        detailed_signal, G_OBJECT_TYPE_NAME (instance));
+	g_signal_query (signal_id, &query);
+
+	container_info = g_irepository_find_by_gtype (g_irepository_get_default (),
+	                                              query.itype);
+	signal_info = container_info
+		? get_signal_info (container_info, query.signal_name)
+		: NULL;
+	if (container_info)
+		g_base_info_unref (container_info);
+	if (!signal_info)
+		ccroak ("Could not find signal %s of %s in the typelib",
+		        query.signal_name, g_type_name (query.itype));
+	/* swapping exchanges what the first and last args hold */
+	if (!native_signature_matches (
+	       native, signal_info, TRUE,
+	       swapped ? data_type : G_OBJECT_TYPE (instance),
+	       swapped ? G_OBJECT_TYPE (instance) : data_type))
+	{
+		g_base_info_unref (signal_info);
+		ccroak ("%s does not match the signature of signal %s",
+		        g_base_info_get_name (native->info), query.signal_name);
+	}
+	g_base_info_unref (signal_info);
+
+	closure = swapped
+		? g_cclosure_new_swap (G_CALLBACK (native->func),
+		                       closure_data, closure_notify)
+		: g_cclosure_new (G_CALLBACK (native->func),
+		                  closure_data, closure_notify);
+	if (data)
+		g_object_ref (data);
+	/* the closure now owns the C callback's data */
+	if (native->wrapper && native->wrapper->data)
+		native->wrapper->destroy = NULL;
+	g_closure_set_marshal (closure, g_cclosure_marshal_generic);
+
+	return g_signal_connect_closure_by_id (instance, signal_id, detail,
+	                                       closure, after);
+}
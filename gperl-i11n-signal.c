@@ -0,0 +1,322 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+/* Generic signal marshallers.  They are either installed for individual
+ * signals while setting up, or, for namespaces that use them for all signals,
+ * the first time a handler is connected to a signal.  The latter are shared
+ * by all signals with the same signature.  Marshallers are never freed since
+ * gperl_signal_set_marshaller_for provides no hook for it. */
+
+G_LOCK_DEFINE_STATIC (generic_signal_marshallers);
+
+/* namespace => itself; the namespaces that use generic marshallers for all
+ * signals */
+static GHashTable *generic_signal_namespaces = NULL;
+/* "type:signal" => itself; the signals that have been taken care of, keyed by
+ * the type they were configured for and the canonical signal name.  Signal
+ * ids cannot be used since explicit configuration happens before classes are
+ * initialized. */
+static GHashTable *prepared_signals = NULL;
+/* signature => GClosureMarshal */
+static GHashTable *shared_signal_marshallers = NULL;
+
+#if GI_CHECK_VERSION (1, 33, 10)
+
+/* Creates a marshaller that invokes Perl handlers as described by
+ * signal_info, converting the args with args_converter if given. */
+static GClosureMarshal
+create_generic_signal_marshaller (GISignalInfo *interface, SV *args_converter)
+{
+	GPerlI11nPerlSignalInfo *signal_info;
+	struct _GPerlI11nArgsConversion *conversion = NULL;
+	GIBaseInfo *closure_marshal_info;
+	ffi_cif *cif;
+	ffi_closure *closure;
+
+	/* A declarative conversion is run by the marshaller itself.  It is
+	 * compiled first since an invalid one croaks. */
+	if (args_converter && gperl_sv_is_array_ref (args_converter))
+		conversion = args_conversion_new (interface,
+		                                  (AV *) SvRV (args_converter));
+
+	g_atomic_int_inc (&n_perl_callback_closures);
+	signal_info = g_new0 (GPerlI11nPerlSignalInfo, 1);
+	signal_info->interface = g_base_info_ref (interface);
+#ifdef PERL_IMPLICIT_CONTEXT
+	signal_info->priv = aTHX;
+#endif
+	signal_info->plan = perl_plan_new (signal_info->interface);
+	if (conversion) {
+		signal_info->plan->conversion = conversion;
+	} else if (args_converter && gperl_sv_is_defined (args_converter)) {
+		signal_info->args_converter = SvREFCNT_inc (args_converter);
+		remember_signal_args_converter (signal_info, args_converter);
+	}
+
+	closure_marshal_info = g_irepository_find_by_name (g_irepository_get_default (),
+	                                                   "GObject",
+	                                                   "ClosureMarshal");
+	g_assert (closure_marshal_info);
+	cif = g_new0 (ffi_cif, 1);
+#if GI_CHECK_VERSION (1, 72, 0)
+	closure = g_callable_info_create_closure (closure_marshal_info,
+	                                          cif,
+	                                          invoke_perl_signal_handler,
+	                                          signal_info);
+        if (closure != NULL)
+                closure =
+                        (ffi_closure *) g_callable_info_get_closure_native_address (closure_marshal_info,
+                                                                                    closure);
+#else
+        G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+	closure = g_callable_info_prepare_closure (closure_marshal_info,
+	                                           cif,
+	                                           invoke_perl_signal_handler,
+	                                           signal_info);
+        G_GNUC_END_IGNORE_DEPRECATIONS
+#endif
+	g_base_info_unref (closure_marshal_info);
+
+	dwarn ("signal = %s => closure = %p\n",
+	       g_base_info_get_name (interface), closure);
+	return (GClosureMarshal) closure;
+}
+
+static void
+_append_type_signature (GString *signature, GITypeInfo *type_info)
+{
+	GITypeTag tag = g_type_info_get_tag (type_info);
+	GITypeInfo *param_type;
+	GIBaseInfo *interface;
+	gint i, n_params = 0;
+
+	g_string_append_printf (signature, "%d%s", tag,
+	                        g_type_info_is_pointer (type_info) ? "*" : "");
+	switch (tag) {
+	    case GI_TYPE_TAG_INTERFACE:
+		interface = g_type_info_get_interface (type_info);
+		g_string_append_printf (signature, "<%s.%s>",
+		                        g_base_info_get_namespace (interface),
+		                        g_base_info_get_name (interface));
+		g_base_info_unref (interface);
+		break;
+	    case GI_TYPE_TAG_ARRAY:
+		g_string_append_printf (signature, "[%d,%d,%d,%d]",
+		                        g_type_info_get_array_type (type_info),
+		                        g_type_info_get_array_length (type_info),
+		                        g_type_info_get_array_fixed_size (type_info),
+		                        g_type_info_is_zero_terminated (type_info));
+		n_params = 1;
+		break;
+	    case GI_TYPE_TAG_GLIST:
+	    case GI_TYPE_TAG_GSLIST:
+		n_params = 1;
+		break;
+	    case GI_TYPE_TAG_GHASH:
+		n_params = 2;
+		break;
+	    default:
+		break;
+	}
+	for (i = 0; i < n_params; i++) {
+		param_type = g_type_info_get_param_type (type_info, i);
+		g_string_append_c (signature, '(');
+		_append_type_signature (signature, param_type);
+		g_string_append_c (signature, ')');
+		g_base_info_unref (param_type);
+	}
+}
+
+/* Describes everything about signal_info that its marshaller depends on.
+ * The caller owns the return value. */
+static gchar *
+_get_signal_signature (GISignalInfo *signal_info)
+{
+	GString *signature = g_string_new (NULL);
+	GIBaseInfo *container = g_base_info_get_container (signal_info);
+	GIArgInfo arg_info;
+	GITypeInfo type_info;
+	gint i, n_args;
+
+	/* only object instances are marshalled independently of their
+	 * type */
+	if (!GI_IS_OBJECT_INFO (container) && !GI_IS_INTERFACE_INFO (container))
+		g_string_append_printf (signature, "%s.%s:",
+		                        g_base_info_get_namespace (container),
+		                        g_base_info_get_name (container));
+
+	n_args = g_callable_info_get_n_args (signal_info);
+	for (i = 0; i < n_args; i++) {
+		g_callable_info_load_arg (signal_info, i, &arg_info);
+		g_arg_info_load_type (&arg_info, &type_info);
+		g_string_append_printf (signature, "%d%d%d",
+		                        g_arg_info_get_direction (&arg_info),
+		                        g_arg_info_get_ownership_transfer (&arg_info),
+		                        g_arg_info_is_caller_allocates (&arg_info));
+		_append_type_signature (signature, &type_info);
+		g_string_append_c (signature, ',');
+	}
+
+	g_callable_info_load_return_type (signal_info, &type_info);
+	g_string_append_printf (signature, "->%d%d",
+	                        g_callable_info_get_caller_owns (signal_info),
+	                        g_callable_info_may_return_null (signal_info));
+	_append_type_signature (signature, &type_info);
+
+	return g_string_free (signature, FALSE);
+}
+
+static GClosureMarshal
+_get_shared_signal_marshaller (GISignalInfo *signal_info)
+{
+	gchar *signature = _get_signal_signature (signal_info);
+	GClosureMarshal marshaller;
+
+	G_LOCK (generic_signal_marshallers);
+	marshaller = shared_signal_marshallers
+		? g_hash_table_lookup (shared_signal_marshallers, signature)
+		: NULL;
+	G_UNLOCK (generic_signal_marshallers);
+	if (marshaller) {
+		g_free (signature);
+		return marshaller;
+	}
+
+	marshaller = create_generic_signal_marshaller (signal_info, NULL);
+	G_LOCK (generic_signal_marshallers);
+	if (!shared_signal_marshallers)
+		shared_signal_marshallers =
+			g_hash_table_new_full (g_str_hash, g_str_equal,
+			                       g_free, NULL);
+	g_hash_table_replace (shared_signal_marshallers, signature, marshaller);
+	G_UNLOCK (generic_signal_marshallers);
+	return marshaller;
+}
+
+#endif
+
+static gchar *
+_format_prepared_signal_key (GType gtype, const gchar *signal_name)
+{
+	gchar *key = g_strdup_printf ("%s:%s", g_type_name (gtype), signal_name);
+	g_strdelimit (key + strlen (g_type_name (gtype)) + 1, "_", '-');
+	return key;
+}
+
+static gboolean
+_is_signal_prepared (GType gtype, const gchar *signal_name)
+{
+	gchar *key;
+	gboolean result;
+
+	if (!g_atomic_pointer_get (&prepared_signals))
+		return FALSE;
+	key = _format_prepared_signal_key (gtype, signal_name);
+	G_LOCK (generic_signal_marshallers);
+	result = g_hash_table_contains (prepared_signals, key);
+	G_UNLOCK (generic_signal_marshallers);
+	g_free (key);
+	return result;
+}
+
+/* Records that the signal of gtype has been given a marshaller.  Returns FALSE
+ * if that was the case already. */
+static gboolean
+mark_signal_prepared (GType gtype, const gchar *signal_name)
+{
+	gchar *key;
+	gboolean is_new = FALSE;
+
+	key = _format_prepared_signal_key (gtype, signal_name);
+
+	G_LOCK (generic_signal_marshallers);
+	if (!prepared_signals)
+		prepared_signals = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                          g_free, NULL);
+	if (!g_hash_table_contains (prepared_signals, key)) {
+		g_hash_table_add (prepared_signals, key);
+		key = NULL;
+		is_new = TRUE;
+	}
+	G_UNLOCK (generic_signal_marshallers);
+
+	g_free (key);
+	return is_new;
+}
+
+static void
+enable_generic_signal_marshallers (const gchar *namespace)
+{
+#if !GI_CHECK_VERSION (1, 33, 10)
+	warn ("*** Cannot use generic signal marshallers for %s "
+	      "unless gobject-introspection >= 1.33.10\n",
+	      namespace);
+	return;
+#endif
+	G_LOCK (generic_signal_marshallers);
+	if (!generic_signal_namespaces)
+		generic_signal_namespaces =
+			g_hash_table_new_full (g_str_hash, g_str_equal,
+			                       g_free, NULL);
+	g_hash_table_add (generic_signal_namespaces, g_strdup (namespace));
+	G_UNLOCK (generic_signal_marshallers);
+}
+
+static gboolean
+_uses_generic_signal_marshallers (const gchar *namespace)
+{
+	gboolean result;
+	G_LOCK (generic_signal_marshallers);
+	result = generic_signal_namespaces &&
+	         g_hash_table_contains (generic_signal_namespaces, namespace);
+	G_UNLOCK (generic_signal_marshallers);
+	return result;
+}
+
+/* Called before a handler is connected to detailed_signal of an instance of
+ * instance_type.  Installs the shared generic marshaller for the signal if
+ * it belongs to a namespace that uses them and if it has not been prepared
+ * yet.  Unknown signals are left for the connect call to report. */
+static void
+prepare_generic_signal_marshaller (GType instance_type, const gchar *detailed_signal)
+{
+	guint signal_id;
+	GQuark detail;
+	GSignalQuery query;
+	GIBaseInfo *container_info;
+	GISignalInfo *signal_info = NULL;
+
+	if (!g_atomic_pointer_get (&generic_signal_namespaces))
+		return;
+	if (!g_signal_parse_name (detailed_signal, instance_type,
+	                          &signal_id, &detail, FALSE))
+		return;
+	g_signal_query (signal_id, &query);
+	if (_is_signal_prepared (query.itype, query.signal_name))
+		return;
+
+	container_info = g_irepository_find_by_gtype (g_irepository_get_default (),
+	                                              query.itype);
+	if (!container_info)
+		return;
+	if (_uses_generic_signal_marshallers (g_base_info_get_namespace (container_info)))
+		signal_info = get_signal_info (container_info, query.signal_name);
+	g_base_info_unref (container_info);
+	if (!signal_info)
+		return;
+
+	/* The signal is only marked once it gets a marshaller, so that its
+	 * namespace can still enable generic marshallers later on. */
+	if (!mark_signal_prepared (query.itype, query.signal_name)) {
+		g_base_info_unref (signal_info);
+		return;
+	}
+
+#if GI_CHECK_VERSION (1, 33, 10)
+	dwarn ("lazily installing a generic marshaller for %s::%s\n",
+	       g_type_name (query.itype), query.signal_name);
+	gperl_signal_set_marshaller_for (query.itype,
+	                                 (gchar *) query.signal_name,
+	                                 _get_shared_signal_marshaller (signal_info));
+#endif
+	g_base_info_unref (signal_info);
+}
@@ -0,0 +1,74 @@
+/* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
+
+/* Module state that refers to Perl data is kept in MY_CXT, so that every
+ * ithread works with its own copies.  It is fetched again in CLONE, where the
+ * package variables it points to have already been cloned.  The C-level
+ * caches only hold introspection data, plans and GTypes, which do not belong
+ * to any interpreter, so they are shared by all of them. */
+
+static void
+_release_module_state (pTHX_ void *data)
+{
+	dMY_CXT;
+	PERL_UNUSED_VAR (data);
+	/* Make sure that nothing is routed to this interpreter anymore, and
+	 * release the async callbacks it still owns. */
+#ifdef PERL_IMPLICIT_CONTEXT
+	enable_foreign_thread_dispatch (aTHX, FALSE);
+#else
+	enable_foreign_thread_dispatch (NULL, FALSE);
+#endif
+	release_finished_async_perl_callbacks ();
+	clear_resolved_methods (NULL);
+	g_hash_table_destroy (MY_CXT.resolved_methods);
+	MY_CXT.resolved_methods = NULL;
+	/* The closures themselves are still referenced by class structs. */
+	g_hash_table_destroy (MY_CXT.vfunc_closures);
+	MY_CXT.vfunc_closures = NULL;
+}
+
+static void
+init_module_state (void)
+{
+	dMY_CXT;
+	MY_CXT.basename_to_package =
+		get_hv ("Glib::Object::Introspection::_BASENAME_TO_PACKAGE", GV_ADD);
+	MY_CXT.forbidden_sub_names =
+		get_hv ("Glib::Object::Introspection::_FORBIDDEN_SUB_NAMES", GV_ADD);
+	MY_CXT.signal_args_converters =
+		get_hv ("Glib::Object::Introspection::_SIGNAL_ARGS_CONVERTERS", GV_ADD);
+	/* A clone must not use the parent's resolved subs. */
+	MY_CXT.resolved_methods = new_resolved_methods_table ();
+	g_queue_init (&MY_CXT.resolved_methods_lru);
+	/* Nor the parent's vfunc closures, which call into the parent. */
+	MY_CXT.vfunc_closures = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                               g_free, NULL);
+	call_atexit (_release_module_state, NULL);
+}
+
+/* The converters are also stored in a package variable, keyed by the signal
+ * info, so that cloned interpreters find their own copies. */
+static void
+remember_signal_args_converter (const GPerlI11nPerlSignalInfo *signal_info,
+                                SV *args_converter)
+{
+	gchar key[32];
+	dMY_CXT;
+	g_snprintf (key, sizeof (key), "%p", signal_info);
+	(void) hv_store (MY_CXT.signal_args_converters, key, strlen (key),
+	                 newSVsv (args_converter), 0);
+}
+
+static SV *
+find_signal_args_converter (gpointer perl_context,
+                            const GPerlI11nPerlSignalInfo *signal_info)
+{
+	gchar key[32];
+	SV **svp;
+	dTHXa (perl_context);
+	dMY_CXT;
+	PERL_UNUSED_VAR (perl_context);
+	g_snprintf (key, sizeof (key), "%p", signal_info);
+	svp = hv_fetch (MY_CXT.signal_args_converters, key, strlen (key), 0);
+	return svp ? *svp : NULL;
+}
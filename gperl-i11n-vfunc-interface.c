@@ -1,12 +1,59 @@
 /* -*- mode: c; indent-tabs-mode: t; c-basic-offset: 8; -*- */
 
+/* Interfaces added while perl is still compiling the program, for which
+ * hooking up the vfuncs is deferred until INIT. */
+typedef struct {
+	gpointer iface;
+	GPerlI11nInterfaceData *data;
+} GPerlI11nDeferredInterface;
+
+static GSList *deferred_interfaces = NULL;
+
+/* The interface structs of derived types whose classes have already been
+ * initialized are copies of ours, made before we changed it.  So update
+ * their slots too, unless they were changed in the meantime. */
 static void
-generic_interface_init (gpointer iface, gpointer data)
+_update_derived_iface_slots (GType type,
+                             GType iface_type,
+                             gint field_offset,
+                             gpointer old_value,
+                             gpointer new_value)
+{
+	GType *children;
+	guint n_children, i;
+	children = g_type_children (type, &n_children);
+	for (i = 0; i < n_children; i++) {
+		gpointer klass = g_type_class_peek (children[i]);
+		gpointer iface = klass
+			? g_type_interface_peek (klass, iface_type)
+			: NULL;
+		if (iface &&
+		    G_STRUCT_MEMBER (gpointer, iface, field_offset) == old_value)
+		{
+			G_STRUCT_MEMBER (gpointer, iface, field_offset) = new_value;
+		}
+		_update_derived_iface_slots (children[i], iface_type,
+		                             field_offset, old_value, new_value);
+	}
+	g_free (children);
+}
+
+static void
+_install_interface_vfuncs (gpointer iface,
+                           GPerlI11nInterfaceData *data,
+                           gboolean only_implemented)
 {
-	GIInterfaceInfo *info = data;
+	GIInterfaceInfo *info = data->info;
 	GIStructInfo *struct_info;
+	HV *stash = NULL;
+	GType target_type = 0, iface_type = 0;
 	gint n, i;
 	struct_info = g_interface_info_get_iface_struct (info);
+	if (only_implemented) {
+		stash = gv_stashpv (data->target_package, 0);
+		target_type = gperl_object_type_from_package (data->target_package);
+		iface_type = get_gtype (info);
+	}
 	n = g_interface_info_get_n_vfuncs (info);
 	for (i = 0; i < n; i++) {
 		GIVFuncInfo *vfunc_info;
@@ -17,6 +64,7 @@ generic_interface_init (gpointer iface, gpointer data)
 		GIBaseInfo *field_interface_info;
 		gchar *perl_method_name;
 		GPerlI11nPerlCallbackInfo *callback_info;
+		gpointer old_value;
 
 		vfunc_info = g_interface_info_get_vfunc (info, i);
 		vfunc_name = g_base_info_get_name (vfunc_info);
@@ -36,24 +84,55 @@ generic_interface_init (gpointer iface, gpointer data)
 		field_info = get_field_info (struct_info, vfunc_name);
 		g_assert (field_info);
 		field_offset = g_field_info_get_offset (field_info);
+
+		if (only_implemented) {
+			/* As for objects, if there is no implementation of
+			 * this vfunc at INIT time, we leave the slot in the
+			 * interface struct alone.  Unless it is empty: then
+			 * we still install the shared closure, so that a call
+			 * croaks about the missing method instead of jumping
+			 * to NULL. */
+			GV * slot = stash
+				? gv_fetchmethod (stash, perl_method_name)
+				: NULL;
+			if ((!slot || !GvCV (slot)) &&
+			    G_STRUCT_MEMBER (gpointer, iface, field_offset) != NULL)
+			{
+				dwarn ("skipping vfunc %s.%s because it has no implementation\n",
+				      g_base_info_get_name (info), vfunc_name);
+				g_base_info_unref (field_info);
+				g_base_info_unref (vfunc_info);
+				g_free (perl_method_name);
+				continue;
+			}
+		}
+
 		field_type_info = g_field_info_get_type (field_info);
 		field_interface_info = g_type_info_get_interface (field_type_info);
 
-		/* callback_info takes over ownership of perl_method_name. */
-		callback_info = create_perl_callback_closure_for_named_sub (
-		                  field_interface_info, perl_method_name);
+		/* The closure is shared with all other classes implementing
+		 * this vfunc. */
+		callback_info = get_shared_perl_callback_closure_for_vfunc (
+		                  info, field_interface_info, perl_method_name);
 		dwarn ("installing vfunc %s.%s as %s at offset %d (vs. %d) inside %p\n",
 		       g_base_info_get_name (info), vfunc_name, perl_method_name,
 		       field_offset, g_vfunc_info_get_offset (vfunc_info),
 		       iface);
 
+		old_value = G_STRUCT_MEMBER (gpointer, iface, field_offset);
 #if GI_CHECK_VERSION (1, 72, 0)
 		G_STRUCT_MEMBER (gpointer, iface, field_offset) =
                         g_callable_info_get_closure_native_address (vfunc_info, callback_info->closure);
 #else
 		G_STRUCT_MEMBER (gpointer, iface, field_offset) = callback_info->closure;
 #endif
+		if (only_implemented && target_type)
+			_update_derived_iface_slots (
+				target_type, iface_type, field_offset,
+				old_value,
+				G_STRUCT_MEMBER (gpointer, iface, field_offset));
 
+		g_free (perl_method_name);
 		g_base_info_unref (field_interface_info);
 		g_base_info_unref (field_type_info);
 		g_base_info_unref (field_info);
@@ -62,11 +141,52 @@ generic_interface_init (gpointer iface, gpointer data)
 	g_base_info_unref (struct_info);
 }
 
+static void
+generic_interface_init (gpointer iface, gpointer data)
+{
+	GPerlI11nInterfaceData *iface_data = data;
+	if (iface_data->defer) {
+		/* Glib::Object::Subclass registers the type, and thus
+		 * initializes the interface, before perl has compiled the
+		 * package's subs.  So wait until INIT before looking for
+		 * implementations. */
+		GPerlI11nDeferredInterface *deferred =
+			g_new0 (GPerlI11nDeferredInterface, 1);
+		dwarn ("deferring %s for %s\n",
+		       g_base_info_get_name (iface_data->info),
+		       iface_data->target_package);
+		deferred->iface = iface;
+		deferred->data = iface_data;
+		deferred_interfaces = g_slist_prepend (deferred_interfaces, deferred);
+		return;
+	}
+	/* Outside of perl's compilation phase, we cannot know whether
+	 * implementations will still be added later, so we hook up all
+	 * vfuncs. */
+	_install_interface_vfuncs (iface, iface_data, FALSE);
+}
+
+static void
+install_deferred_interface_vfuncs (void)
+{
+	GSList *l;
+	deferred_interfaces = g_slist_reverse (deferred_interfaces);
+	for (l = deferred_interfaces; l != NULL; l = l->next) {
+		GPerlI11nDeferredInterface *deferred = l->data;
+		_install_interface_vfuncs (deferred->iface, deferred->data, TRUE);
+		g_free (deferred);
+	}
+	g_slist_free (deferred_interfaces);
+	deferred_interfaces = NULL;
+}
+
 static void
 generic_interface_finalize (gpointer iface, gpointer data)
 {
-	GIInterfaceInfo *info = data;
+	GPerlI11nInterfaceData *iface_data = data;
 	PERL_UNUSED_VAR (iface);
-	dwarn ("info = %p\n", info);
-	g_base_info_unref ((GIBaseInfo *) info);
+	dwarn ("info = %p\n", iface_data->info);
+	g_base_info_unref ((GIBaseInfo *) iface_data->info);
+	g_free (iface_data->target_package);
+	g_free (iface_data);
 }
@@ -11,103 +11,309 @@ store_objects_with_vfuncs (AV *objects_with_vfuncs, GIObjectInfo *info)
 
 /* ------------------------------------------------------------------------- */
 
-static void
-generic_class_init (GIObjectInfo *info, const gchar *target_package, gpointer class)
+/* Vfunc tables are built once per object type and never freed.  They are
+ * shared by all interpreters, so they are guarded by the cache lock. */
+static GHashTable *vfunc_tables = NULL;
+
+static GPerlI11nVFuncTable *
+_build_vfunc_table (GIObjectInfo *info)
 {
+	GPerlI11nVFuncTable *table;
 	GIStructInfo *struct_info;
 	gint n, i;
-	struct_info = g_object_info_get_class_struct (info);
+
+	table = g_new0 (GPerlI11nVFuncTable, 1);
+	table->info = g_base_info_ref (info);
 	n = g_object_info_get_n_vfuncs (info);
+	if (n <= 0)
+		return table;
+
+	struct_info = g_object_info_get_class_struct (info);
+	g_assert (struct_info);
+	table->n_vfuncs = (guint) n;
+	table->vfuncs = g_new0 (GPerlI11nVFuncEntry, n);
 	for (i = 0; i < n; i++) {
-		GIVFuncInfo *vfunc_info;
-		const gchar *vfunc_name;
+		GPerlI11nVFuncEntry *entry = &table->vfuncs[i];
 		GIFieldInfo *field_info;
-		gint field_offset;
 		GITypeInfo *field_type_info;
-		GIBaseInfo *field_interface_info;
-		gchar *perl_method_name;
-		GPerlI11nPerlCallbackInfo *callback_info;
 
-		vfunc_info = g_object_info_get_vfunc (info, i);
-		vfunc_name = g_base_info_get_name (vfunc_info);
+		entry->vfunc_info = g_object_info_get_vfunc (info, i);
+		entry->name = g_base_info_get_name (entry->vfunc_info);
 
-		perl_method_name = g_ascii_strup (vfunc_name, -1);
-		if (is_forbidden_sub_name (perl_method_name)) {
+		entry->perl_method_name = g_ascii_strup (entry->name, -1);
+		if (is_forbidden_sub_name (entry->perl_method_name)) {
 			/* If the method name coincides with the name of one of
 			 * perl's special subs, add "_VFUNC". */
-			gchar *replacement = g_strconcat (perl_method_name, "_VFUNC", NULL);
-			g_free (perl_method_name);
-			perl_method_name = replacement;
+			gchar *replacement = g_strconcat (entry->perl_method_name, "_VFUNC", NULL);
+			g_free (entry->perl_method_name);
+			entry->perl_method_name = replacement;
 		}
 
+		/* We use the field information here rather than the vfunc
+		 * information so that the Perl invoker does not have to deal
+		 * with an implicit invocant.  FIXME: g_vfunc_info_get_offset
+		 * does not seem to work here. */
+		field_info = get_field_info (struct_info, entry->name);
+		g_assert (field_info);
+		entry->field_offset = g_field_info_get_offset (field_info);
+		field_type_info = g_field_info_get_type (field_info);
+		entry->field_interface_info = g_type_info_get_interface (field_type_info);
+		g_base_info_unref (field_type_info);
+		g_base_info_unref (field_info);
+	}
+	g_base_info_unref (struct_info);
+
+	return table;
+}
+
+static void
+_free_vfunc_table (GPerlI11nVFuncTable *table)
+{
+	guint i;
+	for (i = 0; i < table->n_vfuncs; i++) {
+		GPerlI11nVFuncEntry *entry = &table->vfuncs[i];
+		g_base_info_unref (entry->vfunc_info);
+		g_free (entry->perl_method_name);
+		g_base_info_unref (entry->field_interface_info);
+	}
+	g_free (table->vfuncs);
+	g_base_info_unref (table->info);
+	g_free (table);
+}
+
+static GPerlI11nVFuncTable *
+_lookup_vfunc_table (GType gtype)
+{
+	GPerlI11nVFuncTable *table;
+	G_LOCK (cache);
+	table = vfunc_tables
+		? g_hash_table_lookup (vfunc_tables, (gpointer) gtype)
+		: NULL;
+	G_UNLOCK (cache);
+	return table;
+}
+
+/* The table is owned by the cache. */
+static const GPerlI11nVFuncTable *
+get_vfunc_table (GIObjectInfo *info)
+{
+	GType gtype;
+	GPerlI11nVFuncTable *table, *cached_table;
+
+	gtype = get_gtype (info);
+	table = _lookup_vfunc_table (gtype);
+	if (table)
+		return table;
+
+	table = _build_vfunc_table (info);
+
+	G_LOCK (cache);
+	if (!vfunc_tables)
+		vfunc_tables = g_hash_table_new (g_direct_hash, g_direct_equal);
+	cached_table = g_hash_table_lookup (vfunc_tables, (gpointer) gtype);
+	if (!cached_table)
+		g_hash_table_insert (vfunc_tables, (gpointer) gtype, table);
+	G_UNLOCK (cache);
+
+	if (cached_table) {
+		_free_vfunc_table (table);
+		return cached_table;
+	}
+	return table;
+}
+
+/* Like get_vfunc_table, but for an object type known to the repository.  The
+ * repository is only consulted when the table is built. */
+static const GPerlI11nVFuncTable *
+get_vfunc_table_for_gtype (GType gtype)
+{
+	const GPerlI11nVFuncTable *table;
+	GIObjectInfo *info;
+
+	table = _lookup_vfunc_table (gtype);
+	if (table)
+		return table;
+
+	info = g_irepository_find_by_gtype (g_irepository_get_default (), gtype);
+	g_assert (info && GI_IS_OBJECT_INFO (info));
+	table = get_vfunc_table (info);
+	g_base_info_unref (info);
+	return table;
+}
+
+static const GPerlI11nVFuncEntry *
+find_vfunc_entry (const GPerlI11nVFuncTable *table, const gchar *vfunc_name)
+{
+	gint index = find_member_index (table->info, GPERL_I11N_MEMBER_VFUNC,
+	                                vfunc_name);
+	return index >= 0 ? &table->vfuncs[index] : NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void
+generic_class_init (GIObjectInfo *info, const gchar *target_package, gpointer class)
+{
+	const GPerlI11nVFuncTable *table;
+	HV *stash;
+	guint i;
+
+	table = get_vfunc_table (info);
+	stash = gv_stashpv (target_package, 0);
+	for (i = 0; i < table->n_vfuncs; i++) {
+		const GPerlI11nVFuncEntry *entry = &table->vfuncs[i];
+		GPerlI11nPerlCallbackInfo *callback_info;
+
 		{
 			/* If there is no implementation of this vfunc at INIT
 			 * time, we assume that the intention is to provide no
 			 * implementation and we thus skip setting up the class
 			 * struct member. */
-			HV * stash = gv_stashpv (target_package, 0);
-			GV * slot = gv_fetchmethod (stash, perl_method_name);
+			GV * slot = gv_fetchmethod (stash, entry->perl_method_name);
 			if (!slot || !GvCV (slot)) {
 				dwarn ("skipping vfunc %s.%s because it has no implementation\n",
-				      g_base_info_get_name (info), vfunc_name);
-				g_base_info_unref (vfunc_info);
-				g_free (perl_method_name);
+				      g_base_info_get_name (info), entry->name);
 				continue;
 			}
 		}
 
-		/* We use the field information here rather than the vfunc
-		 * information so that the Perl invoker does not have to deal
-		 * with an implicit invocant. */
-		field_info = get_field_info (struct_info, vfunc_name);
-		g_assert (field_info);
-		field_offset = g_field_info_get_offset (field_info);
-		field_type_info = g_field_info_get_type (field_info);
-		field_interface_info = g_type_info_get_interface (field_type_info);
-
-		/* callback_info takes over ownership of perl_method_name. */
-		callback_info = create_perl_callback_closure_for_named_sub (
-		                  field_interface_info, perl_method_name);
+		/* The closure is shared with all other classes implementing
+		 * this vfunc. */
+		callback_info = get_shared_perl_callback_closure_for_vfunc (
+		                  info, entry->field_interface_info,
+		                  entry->perl_method_name);
 		dwarn ("installing vfunc %s.%s as %s at offset %d (vs. %d) inside %p\n",
-		       g_base_info_get_name (info), vfunc_name, perl_method_name,
-		       field_offset, g_vfunc_info_get_offset (vfunc_info),
+		       g_base_info_get_name (info), entry->name, entry->perl_method_name,
+		       entry->field_offset, g_vfunc_info_get_offset (entry->vfunc_info),
 		       class);
 
 #if GI_CHECK_VERSION (1, 72, 0)
-                G_STRUCT_MEMBER (gpointer, class, field_offset) =
-                        g_callable_info_get_closure_native_address (vfunc_info, callback_info->closure);
+                G_STRUCT_MEMBER (gpointer, class, entry->field_offset) =
+                        g_callable_info_get_closure_native_address (entry->vfunc_info, callback_info->closure);
 #else
-		G_STRUCT_MEMBER (gpointer, class, field_offset) = callback_info->closure;
+		G_STRUCT_MEMBER (gpointer, class, entry->field_offset) = callback_info->closure;
 #endif
-
-		g_base_info_unref (field_interface_info);
-		g_base_info_unref (field_type_info);
-		g_base_info_unref (field_info);
-		g_base_info_unref (vfunc_info);
 	}
-	g_base_info_unref (struct_info);
 }
 
 /* ------------------------------------------------------------------------- */
 
-static gint
-get_vfunc_offset (GIObjectInfo *info, const gchar *vfunc_name)
+/* The XSUB behind the subs created by install_fallback_vfunc.  Everything but
+ * the function pointer has been resolved beforehand; the function pointer is
+ * read anew on each call, just like C code chaining up would do. */
+static void
+_fallback_vfunc_xsub (pTHX_ CV *cv)
 {
-	GIStructInfo *struct_info;
-	GIFieldInfo *field_info;
-	gint field_offset;
+	dXSARGS;
+	GPerlI11nFallbackVFunc *fallback;
+	gpointer func_pointer;
 
-	struct_info = g_object_info_get_class_struct (info);
-	g_assert (struct_info);
+	fallback = CvXSUBANY (cv).any_ptr;
+	func_pointer = G_STRUCT_MEMBER (gpointer, fallback->klass,
+	                                fallback->field_offset);
+	g_assert (func_pointer);
 
-	field_info = get_field_info (struct_info, vfunc_name);
-	g_assert (field_info);
-	field_offset = g_field_info_get_offset (field_info);
+	SP -= items;
+	invoke_c_code (fallback->plan, func_pointer,
+	               sp, ax, mark, items,
+	               0,
+	               NULL, NULL, NULL);
+	/* SPAGAIN since invoke_c_code probably modified the stack pointer. */
+	SPAGAIN;
+	PUTBACK;
+}
 
-	g_base_info_unref (field_info);
-	g_base_info_unref (struct_info);
+/* Installs an XSUB called sub_name which invokes the implementation of entry
+ * found in klass. */
+static void
+_install_fallback_vfunc (const GPerlI11nVFuncTable *table,
+                         const GPerlI11nVFuncEntry *entry,
+                         gpointer klass,
+                         const gchar *sub_name)
+{
+	GPerlI11nFallbackVFunc *fallback;
+	CV *cv;
+
+	dwarn ("%s.%s as %s\n",
+	       g_base_info_get_name (table->info), entry->name, sub_name);
+
+	fallback = g_new0 (GPerlI11nFallbackVFunc, 1);
+	fallback->klass = klass;
+	fallback->field_offset = entry->field_offset;
+	fallback->plan = get_cached_vfunc_plan (table->info, entry->vfunc_info);
 
-	return field_offset;
+	/* FIXME: fallback is leaked if the sub is ever redefined.  But these
+	 * subs are installed once per implementer and vfunc, so this does not
+	 * add up. */
+	cv = newXS ((char *) sub_name, _fallback_vfunc_xsub, __FILE__);
+	CvXSUBANY (cv).any_ptr = fallback;
 }
 
+/* For each non-Perl parent of target_package, up to and including the type of
+ * object_info, install fallback subs for the vfuncs that it or one of its
+ * parents provide and that it implements in C, unless a sub of that name
+ * exists already.  The ancestry is walked once, and the vfunc tables are
+ * looked up by GType.  Parents in seen were handled for an earlier target and
+ * are skipped; the others are added.  Returns the number of subs installed. */
+static gint
+install_fallback_vfuncs (GIObjectInfo *object_info,
+                         const gchar *target_package,
+                         HV *seen)
+{
+	/* FIXME: we should export gperl_type_reg_quark from Glib */
+	GQuark reg_quark = g_quark_from_static_string ("__gperl_type_reg");
+	GType object_gtype, gtype;
+	GType *parents;
+	guint n_parents = 0, i, j, k;
+	gint n_subs = 0;
 
+	object_gtype = get_gtype (object_info);
+	gtype = gperl_object_type_from_package (target_package);
+	g_assert (gtype);
+
+	/* the non-Perl parents, immediate parent first */
+	parents = g_new (GType, g_type_depth (gtype));
+	while ((gtype = g_type_parent (gtype))) {
+		if (!g_type_get_qdata (gtype, reg_quark))
+			parents[n_parents++] = gtype;
+		if (gtype == object_gtype)
+			break;
+	}
+
+	for (i = 0; i < n_parents; i++) {
+		const gchar *implementer_package;
+		gpointer klass;
+
+		implementer_package = gperl_object_package_from_type (parents[i]);
+		if (hv_exists (seen, implementer_package, strlen (implementer_package)))
+			continue;
+		(void) hv_store (seen, implementer_package,
+		                 strlen (implementer_package), newSViv (1), 0);
+		klass = g_type_class_peek (parents[i]);
+		g_assert (klass);
+
+		for (j = i; j < n_parents; j++) {
+			const GPerlI11nVFuncTable *table =
+				get_vfunc_table_for_gtype (parents[j]);
+			for (k = 0; k < table->n_vfuncs; k++) {
+				const GPerlI11nVFuncEntry *entry = &table->vfuncs[k];
+				gchar *sub_name;
+				CV *cv;
+				if (!G_STRUCT_MEMBER (gpointer, klass, entry->field_offset))
+					continue;
+				sub_name = g_strconcat (implementer_package, "::",
+				                        entry->perl_method_name, NULL);
+				cv = get_cv (sub_name, 0);
+				if (!cv || !(CvROOT (cv) || CvXSUB (cv))) {
+					_install_fallback_vfunc (table, entry, klass,
+					                         sub_name);
+					n_subs++;
+				}
+				g_free (sub_name);
+			}
+		}
+	}
+
+	g_free (parents);
+	return n_subs;
+}
@@ -23,6 +23,8 @@ our $VERSION = '0.051';
 
 use Carp;
 $Carp::Internal{(__PACKAGE__)}++;
+use Time::HiRes qw();
+use Scalar::Util qw();
 
 require XSLoader;
 XSLoader::load(__PACKAGE__, $VERSION);
@@ -34,6 +36,46 @@ our %_FORBIDDEN_SUB_NAMES = map { $_ => 1 } qw/AUTOLOAD CLONE DESTROY BEGIN
 our %_BASENAME_TO_PACKAGE;
 our %_REBLESSERS;
 
+# Startup profile, indexed by basename.  See startup_profile.
+my %PROFILES;
+
+sub _profile_phase {
+  my ($basename, $phase, $start) = @_;
+  $PROFILES{$basename}{phases}{$phase} += Time::HiRes::time() - $start;
+  return Time::HiRes::time();
+}
+
+sub _profile_count {
+  my ($basename, $counter, $n) = @_;
+  $PROFILES{$basename}{counts}{$counter} += $n;
+}
+
+sub _report_startup_profiles {
+  foreach my $basename (sort keys %PROFILES) {
+    my $profile = $PROFILES{$basename};
+    next if $profile->{reported}++;
+    printf STDERR "%s startup profile for %s:\n", __PACKAGE__, $basename;
+    foreach my $phase (sort keys %{$profile->{phases}}) {
+      printf STDERR "  %-28s %10.3f ms\n",
+        $phase, 1000 * $profile->{phases}{$phase};
+    }
+    foreach my $counter (sort keys %{$profile->{counts}}) {
+      printf STDERR "  %-28s %10d\n",
+        $counter, $profile->{counts}{$counter};
+    }
+  }
+}
+
+sub startup_profile {
+  my ($class, $basename) = @_;
+  my %profiles = map {
+    my $profile = $PROFILES{$_};
+    $_ => { phases => { %{$profile->{phases} || {}} },
+            counts => { %{$profile->{counts} || {}} } };
+  } keys %PROFILES;
+  return defined $basename ? $profiles{$basename} : \%profiles;
+}
+
 sub _create_invoker_sub {
   my ($basename, $namespace, $name,
       $shift_package_name, $flatten_array_ref_return,
@@ -69,6 +111,55 @@ sub _create_invoker_sub {
   }
 }
 
+# Turn the only/exclude patterns into code refs deciding whether a name should
+# be set up.  Strings match names exactly, except that '*' matches anything;
+# regular expressions are used as they are.  Names are type names or global
+# function and constant names like 'File' or 'content_type_get_icon', or
+# namespaced names like 'File::new_for_path'.
+sub _create_name_selectors {
+  my ($only, $exclude) = @_;
+  return unless $only || $exclude;
+  my $compile = sub {
+    my ($patterns) = @_;
+    my @regexes = map {
+      if (ref $_ eq 'Regexp') {
+        $_;
+      } else {
+        (my $regex = quotemeta $_) =~ s/\\\*/.*/g;
+        qr/^$regex$/;
+      }
+    } @{$patterns || []};
+    return sub {
+      my ($name) = @_;
+      foreach my $regex (@regexes) {
+        return 1 if $name =~ $regex;
+      }
+      return 0;
+    };
+  };
+  my $matches_only = $compile->($only);
+  my $matches_exclude = $compile->($exclude);
+  # A namespaced 'only' pattern like 'File::new*' also selects its type.
+  my $matches_only_namespace = $compile->([
+    map { m/^(.+?)::/ ? $1 : () } grep { ref $_ ne 'Regexp' } @{$only || []}
+  ]);
+
+  my $select_name = sub {
+    my ($name) = @_;
+    return 0 if $matches_exclude->($name);
+    return 1 if !$only;
+    return $matches_only->($name) || $matches_only_namespace->($name);
+  };
+  my $select_member = sub {
+    my ($namespace, $name) = @_;
+    my $full_name = $namespace . '::' . $name;
+    return 0 if $matches_exclude->($namespace) || $matches_exclude->($full_name);
+    return 1 if !$only;
+    return $matches_only->($namespace) || $matches_only->($full_name);
+  };
+  return ($select_name, $select_member);
+}
+
 sub setup {
   my ($class, %params) = @_;
   my $basename = $params{basename};
@@ -96,27 +187,49 @@ sub setup {
   my %handle_sentinel_boolean_for = exists $params{handle_sentinel_boolean_for}
     ? map { $_ => 1 } @{$params{handle_sentinel_boolean_for}}
     : ();
-  my @use_generic_signal_marshaller_for = exists $params{use_generic_signal_marshaller_for}
-    ? @{$params{use_generic_signal_marshaller_for}}
-    : ();
+  # 'all' may be given on its own or together with explicit entries.
+  my @use_generic_signal_marshaller_for = !exists $params{use_generic_signal_marshaller_for}
+    ? ()
+    : ref $params{use_generic_signal_marshaller_for}
+      ? @{$params{use_generic_signal_marshaller_for}}
+      : ($params{use_generic_signal_marshaller_for});
+  my $use_generic_signal_marshallers_for_all =
+    grep { !ref $_ && $_ eq 'all' } @use_generic_signal_marshaller_for;
+  @use_generic_signal_marshaller_for =
+    grep { ref $_ } @use_generic_signal_marshaller_for;
 
   if (exists $params{reblessers}) {
     $_REBLESSERS{$_} = $params{reblessers}->{$_}
       for keys %{$params{reblessers}}
   }
 
+  my $time = Time::HiRes::time();
   __PACKAGE__->_load_library($basename, $version, $search_path);
+  $time = _profile_phase($basename, 'load_library', $time);
+
+  my ($select_name, $select_member) =
+    _create_name_selectors($params{only}, $params{exclude});
 
-  my ($functions, $constants, $fields, $interfaces, $objects_with_vfuncs) =
-    __PACKAGE__->_register_types($basename, $package);
+  my ($functions, $constants, $fields, $interfaces, $objects_with_vfuncs,
+      $counts) =
+    __PACKAGE__->_register_types($basename, $package, $select_name);
+  $time = _profile_phase($basename, 'register_types', $time);
+  _profile_count($basename, $_, $counts->{$_}) for keys %$counts;
 
   no strict qw(refs);
   no warnings qw(redefine);
 
+  my $n_subs = 0;
+
   foreach my $namespace (keys %{$functions}) {
     my $is_namespaced = $namespace ne "";
     NAME:
     foreach my $name (@{$functions->{$namespace}}) {
+      if ($select_name) {
+        next NAME unless $is_namespaced
+          ? $select_member->($namespace, $name)
+          : $select_name->($name);
+      }
       my $auto_name = $is_namespaced
         ? $package . '::' . $namespace . '::' . $name
         : $package . '::' . $name;
@@ -131,14 +244,25 @@ sub setup {
         $shift_package_name_for{$corrected_name},
         $flatten_array_ref_return_for{$corrected_name},
         $handle_sentinel_boolean_for{$corrected_name});
+      $n_subs++;
     }
   }
+  $time = _profile_phase($basename, 'install_functions', $time);
 
+  my %constant_sub_names;
   foreach my $name (@{$constants}) {
+    next if $select_name && !$select_name->($name);
     my $auto_name = $package . '::' . $name;
     my $corrected_name = exists $name_corrections->{$auto_name}
       ? $name_corrections->{$auto_name}
       : $auto_name;
+    if ($params{inline_constants}) {
+      # Collect the constants here and create constant subs for all of them
+      # in one go below.
+      $constant_sub_names{$name} = $corrected_name
+        unless defined &{$corrected_name};
+      next;
+    }
     # Install a sub which, on the first invocation, calls _fetch_constant and
     # then overrides itself with a constant sub returning that value.
     *{$corrected_name} = sub {
@@ -148,10 +272,17 @@ sub setup {
       }
       return $value;
     };
+    $n_subs++;
+  }
+  if (%constant_sub_names) {
+    __PACKAGE__->_install_constants($basename, \%constant_sub_names);
+    $n_subs += keys %constant_sub_names;
   }
+  $time = _profile_phase($basename, 'install_constants', $time);
 
   foreach my $namespace (keys %{$fields}) {
     foreach my $field_name (@{$fields->{$namespace}}) {
+      next if $select_member && !$select_member->($namespace, $field_name);
       my $auto_name = $package . '::' . $namespace . '::' . $field_name;
       my $corrected_name = exists $name_corrections->{$auto_name}
         ? $name_corrections->{$auto_name}
@@ -167,6 +298,7 @@ sub setup {
         }
         return $old_value;
       };
+      $n_subs++;
     }
   }
 
@@ -174,8 +306,12 @@ sub setup {
     my $adder_name = $package . '::' . $name . '::_ADD_INTERFACE';
     *{$adder_name} = sub {
       my ($class, $target_package) = @_;
-      __PACKAGE__->_add_interface($basename, $name, $target_package);
+      # While perl is still compiling, the implementations have most likely
+      # not been seen yet, so hooking up the vfuncs is delayed until INIT.
+      __PACKAGE__->_add_interface($basename, $name, $target_package,
+                                  ${^GLOBAL_PHASE} eq 'START');
     };
+    $n_subs++;
   }
 
   foreach my $object_name (@{$objects_with_vfuncs}) {
@@ -189,22 +325,86 @@ sub setup {
       push @OBJECT_PACKAGES_WITH_VFUNCS,
            [$basename, $object_name, $target_package];
     };
+    $n_subs++;
   }
+  $time = _profile_phase($basename, 'install_accessors', $time);
+  _profile_count($basename, 'subs_installed', $n_subs);
 
+  my $n_closures = __PACKAGE__->_get_n_perl_callback_closures;
   foreach my $packaged_signal (@use_generic_signal_marshaller_for) {
     __PACKAGE__->_use_generic_signal_marshaller_for (@$packaged_signal);
   }
+  if ($use_generic_signal_marshallers_for_all) {
+    __PACKAGE__->_use_generic_signal_marshallers_for_namespace ($basename);
+    _prepare_signal_marshallers_on_connect();
+  }
+  _profile_phase($basename, 'install_signal_marshallers', $time);
+  _profile_count($basename, 'signal_marshallers_installed',
+                 scalar @use_generic_signal_marshaller_for);
+  _profile_count($basename, 'closures_created',
+                 __PACKAGE__->_get_n_perl_callback_closures - $n_closures);
+
+  # Setups after INIT are reported right away; the others at the end of INIT.
+  if ($ENV{GPERL_I11N_PROFILE} && ${^GLOBAL_PHASE} ne 'START') {
+    _report_startup_profiles();
+  }
 
   return;
 }
 
+# Connecting a signal handler goes through a single hook, installed when it is
+# first needed.  It installs the marshallers of namespaces that use generic
+# signal marshallers for all signals when the first handler is connected to a
+# signal, and it refuses coalesced handlers for signals that return values.
+my $PREPARE_SIGNAL_MARSHALLERS_ON_CONNECT = 0;
+my $CHECK_COALESCED_HANDLERS_ON_CONNECT = 0;
+my $SIGNAL_CONNECT_HOOKED = 0;
+sub _hook_signal_connect {
+  return if $SIGNAL_CONNECT_HOOKED++;
+  no strict qw(refs);
+  no warnings qw(redefine);
+  foreach my $name (qw/signal_connect signal_connect_after
+                       signal_connect_swapped/) {
+    my $connect = \&{'Glib::Object::' . $name};
+    *{'Glib::Object::' . $name} = sub {
+      if (@_ > 1) {
+        __PACKAGE__->_prepare_generic_signal_marshaller ($_[0], $_[1])
+          if $PREPARE_SIGNAL_MARSHALLERS_ON_CONNECT;
+        __PACKAGE__->_check_coalesced_signal_handler ($_[0], $_[1])
+          if $CHECK_COALESCED_HANDLERS_ON_CONNECT && @_ > 2 &&
+             Scalar::Util::blessed ($_[2]) &&
+             $_[2]->isa ('Glib::Object::Introspection::Coalesced');
+      }
+      goto &$connect;
+    };
+  }
+}
+
+sub _prepare_signal_marshallers_on_connect {
+  $PREPARE_SIGNAL_MARSHALLERS_ON_CONNECT = 1;
+  _hook_signal_connect();
+}
+
+sub _check_signal_handlers_on_connect {
+  $CHECK_COALESCED_HANDLERS_ON_CONNECT = 1;
+  _hook_signal_connect();
+}
+
 INIT {
   no strict qw(refs);
 
+  # Hook up the implemented vfuncs of interfaces added during compilation.
+  __PACKAGE__->_install_deferred_interface_vfuncs;
+
   # Hook up the implemented vfuncs first.
   foreach my $target (@OBJECT_PACKAGES_WITH_VFUNCS) {
     my ($basename, $object_name, $target_package) = @{$target};
+    my $time = Time::HiRes::time();
+    my $n_closures = __PACKAGE__->_get_n_perl_callback_closures;
     __PACKAGE__->_install_overrides($basename, $object_name, $target_package);
+    _profile_phase($basename, 'init_install_overrides', $time);
+    _profile_count($basename, 'closures_created',
+                   __PACKAGE__->_get_n_perl_callback_closures - $n_closures);
   }
 
   # And then, for each vfunc in our ancestry that has an implementation, add a
@@ -217,43 +417,71 @@ INIT {
   my %implementer_packages_seen;
   foreach my $target (@OBJECT_PACKAGES_WITH_VFUNCS) {
     my ($basename, $object_name, $target_package) = @{$target};
-    my @non_perl_parent_packages =
-      __PACKAGE__->_find_non_perl_parents($basename, $object_name,
-                                          $target_package);
-
+    my $time = Time::HiRes::time();
     # For each non-Perl parent, look at all the vfuncs it and its parents
     # provide.  For each vfunc which has an implementation in the parent
     # (i.e. the corresponding struct pointer is not NULL), install a fallback
-    # sub which invokes the vfunc implementation.  This assumes that
-    # @non_perl_parent_packages contains the parents in "ancestorial" order,
-    # i.e. the first entry must be the immediate parent.
-    IMPLEMENTER: for (my $i = 0; $i < @non_perl_parent_packages; $i++) {
-      my $implementer_package = $non_perl_parent_packages[$i];
-      next IMPLEMENTER if $implementer_packages_seen{$implementer_package}++;
-      for (my $j = $i; $j < @non_perl_parent_packages; $j++) {
-        my $provider_package = $non_perl_parent_packages[$j];
-        my @vfuncs = __PACKAGE__->_find_vfuncs_with_implementation(
-                       $provider_package, $implementer_package);
-        VFUNC: foreach my $vfunc_name (@vfuncs) {
-          my $perl_vfunc_name = uc $vfunc_name;
-          if (exists $_FORBIDDEN_SUB_NAMES{$perl_vfunc_name}) {
-            $perl_vfunc_name .= '_VFUNC';
-          }
-          my $full_perl_vfunc_name =
-            $implementer_package . '::' . $perl_vfunc_name;
-          next VFUNC if defined &{$full_perl_vfunc_name};
-          *{$full_perl_vfunc_name} = sub {
-            __PACKAGE__->_invoke_fallback_vfunc($provider_package,
-                                                $vfunc_name,
-                                                $implementer_package,
-                                                @_);
-          }
-        }
-      }
-    }
+    # sub which invokes the vfunc implementation.  Each parent is only handled
+    # once, for the first target that has it in its ancestry.
+    my $n_subs = __PACKAGE__->_install_fallback_vfuncs(
+                   $basename, $object_name, $target_package,
+                   \%implementer_packages_seen);
+    _profile_phase($basename, 'init_install_fallback_vfuncs', $time);
+    _profile_count($basename, 'subs_installed', $n_subs);
   }
 
   @OBJECT_PACKAGES_WITH_VFUNCS = ();
+
+  _report_startup_profiles() if $ENV{GPERL_I11N_PROFILE};
+}
+
+sub invoke_async_bulk {
+  my ($class, $basename, $namespace, $function, $arg_tuples, %options) = @_;
+  return $class->_invoke_async_bulk (
+    $basename, $namespace, $function, $arg_tuples,
+    $options{max_in_flight} || 8,
+    $options{batch_size} || 64,
+    $options{on_batch});
+}
+
+sub native_function {
+  my ($class, $basename, $namespace, $function) = @_;
+  return Glib::Object::Introspection::NativeFunction->new (
+    $basename, $namespace, $function);
+}
+
+sub signal_connect_native {
+  my ($class, $instance, $detailed_signal, $native, %options) = @_;
+  return $class->_signal_connect_native (
+    $instance, $detailed_signal, $native, $options{data},
+    $options{swapped} ? 1 : 0, $options{after} ? 1 : 0);
+}
+
+sub warm {
+  my ($class, $library, $entries) = @_;
+  my ($basename) = exists $_BASENAME_TO_PACKAGE{$library}
+    ? ($library)
+    : grep { $_BASENAME_TO_PACKAGE{$_} eq $library } keys %_BASENAME_TO_PACKAGE;
+  croak "Cannot warm '$library': it has not been set up"
+    unless defined $basename;
+  if (!defined $entries) {
+    __PACKAGE__->_warm($basename);
+    return;
+  }
+  my @pairs;
+  foreach my $entry (@$entries) {
+    if (ref $entry eq 'ARRAY') {
+      # An entry of a usage manifest: [basename, namespace, function].
+      next unless $entry->[0] eq $basename;
+      push @pairs, [$entry->[1], $entry->[2]];
+    } else {
+      my ($namespace, $function) = $entry =~ m/^(?:(.+)::)?([^:]+)$/;
+      croak "Cannot warm '$entry': malformed name"
+        unless defined $function;
+      push @pairs, [$namespace, $function];
+    }
+  }
+  __PACKAGE__->_warm($basename, \@pairs);
 }
 
 # Monkey-patch Glib with a generic constructor for boxed types.  Glib cannot
@@ -284,6 +512,116 @@ use overload
                },
       fallback => 1;
 
+package Glib::Object::Introspection::Comparator;
+
+use Carp;
+
+sub new {
+  my ($class, %args) = @_;
+  croak 'A comparator needs either a property or a key function'
+    unless defined $args{property} xor defined $args{key};
+  croak 'The key of a comparator must be a code reference'
+    if defined $args{key} && ref $args{key} ne 'CODE';
+  $args{compare} = 'string' unless defined $args{compare};
+  croak "Unknown comparison '$args{compare}'; use 'numeric' or 'string'"
+    unless $args{compare} eq 'numeric' || $args{compare} eq 'string';
+  return bless \%args, $class;
+}
+
+package Glib::Object::Introspection::Coalesced;
+
+use Carp;
+
+# Where events are not coalesced natively, the handler is called with a single
+# argument tuple per event.
+use overload
+      '&{}' => sub {
+                 my ($coalesced) = @_;
+                 return sub { $coalesced->{code}->([[@_]]) }
+               },
+      fallback => 1;
+
+sub new {
+  my ($class, $code, %args) = @_;
+  croak 'The handler of a coalesced callback must be a code reference'
+    unless ref $code eq 'CODE';
+  # Signals that return values cannot be coalesced.  The marshaller must not
+  # croak, so such handlers are refused when they are connected.
+  Glib::Object::Introspection::_check_signal_handlers_on_connect();
+  return bless { code => $code, max_events => $args{max_events} || 0 }, $class;
+}
+
+package Glib::Object::Introspection::NativeFunction;
+
+# When called from Perl, the function is invoked like any other.
+use overload
+      '&{}' => sub {
+                 my ($native) = @_;
+                 return sub {
+                   Glib::Object::Introspection->invoke (
+                     @$native{qw/basename namespace function/}, @_)
+                 }
+               },
+      fallback => 1;
+
+sub new {
+  my ($class, $basename, $namespace, $function) = @_;
+  # Resolve the symbol now so that unknown functions are reported here.
+  Glib::Object::Introspection->_warm ($basename, [[$namespace, $function]]);
+  return bless { basename => $basename, namespace => $namespace,
+                 function => $function }, $class;
+}
+
+package Glib::Object::Introspection::Future;
+
+sub is_ready {
+  my ($self) = @_;
+  return $self->{ready};
+}
+
+sub on_ready {
+  my ($self, $code) = @_;
+  if ($self->{ready}) {
+    $code->($self);
+  } else {
+    push @{$self->{on_ready}}, $code;
+  }
+  return $self;
+}
+
+sub wait {
+  my ($self) = @_;
+  my $context = Glib::MainContext->default;
+  $context->iteration (1) until $self->{ready};
+  return $self;
+}
+
+sub get {
+  my ($self) = @_;
+  $self->wait;
+  die $self->{error} if exists $self->{error};
+  return wantarray ? @{$self->{results}} : $self->{results}->[-1];
+}
+
+sub _resolve {
+  my ($self, @results) = @_;
+  $self->{results} = \@results;
+  $self->_ready;
+}
+
+sub _fail {
+  my ($self, $error) = @_;
+  $self->{error} = $error;
+  $self->_ready;
+}
+
+sub _ready {
+  my ($self) = @_;
+  $self->{ready} = 1;
+  my $callbacks = delete $self->{on_ready} || [];
+  $_->($self) for @$callbacks;
+}
+
 package Glib::Object::Introspection;
 
 1;
@@ -438,6 +776,15 @@ it might be good only while that object lives.  If in doubt you can
 C<copy>.  Structs from C<copy> or C<new> are yours and live as long as
 referred to from Perl.
 
+Callbacks that C calls exactly once, like the ones given to C<*_async>
+functions, are released after they have run.  To check for leaks in long
+running programs,
+
+  my $counts = Glib::Object::Introspection->async_callback_counts;
+
+returns a hash reference with the number of such callbacks that are still
+C<live>, i.e. waiting to be called, and the number that have been C<released>.
+
 =head2 Callbacks
 
 Use normal Perl callback/closure tricks with callbacks.  The most common use
@@ -474,6 +821,125 @@ other widgets it's usually friendliest to avoid circularities in the first
 place, either by using weak references in the userdata, or possibly locating a
 parent dynamically with C<< $widget->get_ancestor >>.
 
+=head2 Callbacks from other threads
+
+Some C libraries invoke callbacks on threads of their own, like GTask thread
+functions or progress callbacks of GIO operations.  Perl code must not run on
+these threads.  After
+
+  Glib::Object::Introspection->dispatch_foreign_thread_callbacks (1);
+
+such invocations are queued instead and run in batches on the thread-default
+main context of the thread that made this call, for the interpreter it was
+made in.  Callbacks that return values or have out arguments block the calling
+thread until they have run, so the main context has to be iterated for them to
+make progress.  The others return right away and run later with copies of
+their arguments.  Pass a false value to turn dispatching off again.
+
+Perl ithreads are supported: each interpreter keeps its own module state, and
+callbacks and signal handlers are invoked in the interpreter that created
+them.  Likewise, vfunc implementations of classes are invoked in the
+interpreter that set up the class.  The introspection data and the plans
+derived from it are shared by all interpreters.
+
+=head2 Asynchronous operations and futures
+
+Functions following the GIO convention for asynchronous operations, like
+C<Glib::IO::File::read_async>, take a callback that is then expected to call
+the matching C<*_finish> function.  When such a function is called without a
+callback, it returns a C<Glib::Object::Introspection::Future> instead, see
+L</C<< Glib::Object::Introspection->invoke_async >>>.  The C<*_finish> function
+is then called natively once the operation is complete, and the future is
+resolved with what it returns, or failed with the error it reports:
+
+  my $future = $file->read_async (Glib::G_PRIORITY_DEFAULT, undef);
+  $future->on_ready (sub {
+    my $stream = eval { $_[0]->get };
+    ...
+  });
+
+This only happens if a C<*_finish> function exists whose only arguments are the
+source object and the result, and only if the callback is left out: passing
+C<undef> as the callback still starts the operation without notifying anyone.
+
+=head2 Coalescing frequent callbacks
+
+Callbacks and signals that fire at high rates, like file monitor events or
+C<items-changed> of large models, can be delivered in batches instead.  Wrap
+the handler in a C<Glib::Object::Introspection::Coalesced>:
+
+  $model->signal_connect ('items-changed' =>
+    Glib::Object::Introspection::Coalesced->new (sub {
+      my ($events) = @_;
+      foreach my $event (@$events) {
+        my ($model, $position, $removed, $added) = @$event;
+        ...
+      }
+    }, max_events => 1000));
+
+Each invocation is then converted and queued, and the handler is called once
+per main loop iteration with an array reference of the queued argument tuples,
+or as soon as C<max_events> tuples are queued.  This works for callback
+arguments and for signals that use the generic signal marshaller (see
+C<use_generic_signal_marshaller_for>); for other signals, the handler is called
+with one tuple per event.  Callbacks that return values or have output
+arguments cannot be coalesced; connecting such a handler to a signal that
+returns values croaks.
+
+=head2 Sorting with native comparators
+
+Comparison callbacks, like the one taken by C<Glib::IO::ListStore::sort>, can
+be given a declarative comparator instead of a code reference.  The comparison
+then happens in C, and Perl code is only run to compute sort keys, if at all:
+
+  # compare the 'name' property of the elements as strings
+  $store->sort (Glib::Object::Introspection::Comparator->new (
+    property => 'name'));
+
+  # compute a key once per element and compare the keys numerically, in
+  # descending order
+  $store->sort (Glib::Object::Introspection::Comparator->new (
+    key => sub { $_[0]->get_size }, compare => 'numeric', reverse => 1));
+
+C<compare> is either C<'string'> (the default) or C<'numeric'>.  Elements are
+expected to be objects.  For callbacks that are only used during the call, as
+with sorting, each element's key is computed once and remembered until the
+call returns.  Comparators can only be used for callbacks that return an
+integer and take the two elements as their first arguments.
+
+=head2 Native handlers
+
+If the function to be used as a callback or signal handler is itself a C
+function from a typelib, it can be wired in directly, without any Perl code
+running when it is invoked.  Look it up with
+C<< Glib::Object::Introspection->native_function >>, which takes the basename,
+namespace and name of the function as known to C<invoke>, and pass it where a
+callback is expected:
+
+  my $free = Glib::Object::Introspection->native_function (
+    'GLib', undef, 'free');
+  Some::Lib::set_data_full ($key, $pointer, $free);
+
+For signals, use C<< Glib::Object::Introspection->signal_connect_native >>:
+
+  Glib::Object::Introspection->signal_connect_native (
+    $button, 'clicked',
+    Glib::Object::Introspection->native_function ('Gtk', 'Widget', 'destroy'),
+    data => $window, swapped => 1);
+
+It takes the options C<data>, a C<Glib::Object> that is passed as the user
+data, C<swapped> and C<after>, and returns the handler ID.  C callbacks that
+were handed to Perl can be passed on in the same way.  They bring their own
+user data, which the handler takes over, so C<data> cannot be given for them.
+
+The signature of the function is checked against the one of the callback or
+signal first.  Object arguments must be of compatible types, and only untyped
+pointer arguments take any pointer.  As is usual in C, the function may ignore
+trailing arguments, like the user data.  C callbacks whose user data was only
+valid during the call that handed them to Perl cannot be kept by the callee.
+When called from Perl, native functions behave like the function they refer
+to.
+
 =head2 Exception handling
 
 Anything that uses GError in C will C<croak> on failure, setting $@ to a
@@ -612,12 +1078,62 @@ in C<handle_sentinel_boolean_for> may also occur in C<class_static_methods>.
 
 =item use_generic_signal_marshaller_for => [ [package1, signal1, [arg_converter1]], ... ]
 
+=item use_generic_signal_marshaller_for => 'all'
+
+=item use_generic_signal_marshaller_for => [ 'all', [package1, signal1, [arg_converter1]], ... ]
+
 Use an introspection-based generic signal marshaller for the signal C<signal1>
 of type C<package1>.  If given, use the code reference C<arg_converter1> to
 convert the arguments that are passed to the signal handler.  In contrast to
 L<Glib>'s normal signal marshaller, the generic signal marshaller supports,
 among other things, pointer arrays and out arguments.
 
+Instead of a code reference, C<arg_converter1> can be an array reference that
+declares the arguments the handler receives, which avoids an extra Perl call
+per emission.  Each entry is either the position of an argument, 0 being the
+instance and 1 the first signal argument, or an array reference holding such a
+position followed by options: C<< field => NAME >> passes the field C<NAME> of
+a struct argument instead, and C<< package => NAME >> converts an integer into
+a nick of the enum or flags type registered for the package C<NAME>.
+Arguments that are not listed are dropped; the user data is passed as usual.
+
+  ['Gtk3::Dialog', 'response', [0, [1, package => 'Gtk3::ResponseType']]]
+
+With C<'all'>, the generic signal marshaller is used for all signals of the
+library's types.  Marshallers are then installed lazily, the first time a
+handler is connected to a signal with C<signal_connect>,
+C<signal_connect_after> or C<signal_connect_swapped>, and signals with the
+same signature share one marshaller.  Signals that are listed explicitly
+alongside C<'all'> keep their own marshaller and converter.
+
+=item inline_constants => $bool
+
+If true, all constants are turned into proper constant subs during C<setup>,
+instead of being fetched lazily on first use.  This way, perl can inline their
+values into any code compiled after C<setup>, e.g. comparisons against key
+symbols in key event handlers.  The cost is that every constant is fetched
+during C<setup>, even those that are never used.
+
+=item only => [ pattern1, ... ]
+
+=item exclude => [ pattern1, ... ]
+
+Restrict what C<setup> sets up.  Types, global functions and constants are
+matched by their name in the typelib, like C<'File'> or
+C<'content_type_get_icon'>; methods and fields by their namespaced name, like
+C<'File::new_for_path'>.  A pattern is either a string, where C<*> matches any
+sequence of characters, or a regular expression.  If C<only> is given, only
+matching items are set up; selecting a type selects all its methods and
+fields, and a namespaced pattern like C<'File::new*'> also selects its type.
+Items matching C<exclude> are never set up; excluding a type excludes all its
+methods and fields.
+
+Types that are not selected are not registered with L<Glib>, so objects of
+such types are represented by their closest registered ancestor.
+
+  only => ['File', 'FileInfo', 'FileType', 'content_type_*'],
+  exclude => [qr/_async$/, qr/_finish$/],
+
 =item reblessers => { package => \&reblesser, ... }
 
 Tells G:O:I to invoke I<reblesser> whenever a Perl object is created for an
@@ -659,6 +1175,152 @@ include the package name.
 C<< Glib::Object::Introspection->invoke >> returns whatever the function being
 invoked returns.
 
+=head2 C<< Glib::Object::Introspection->invoke_async >>
+
+For functions that block, like those doing I/O or heavy computations without
+touching Perl data, there is C<< Glib::Object::Introspection->invoke_async >>.
+It takes the same arguments as C<< Glib::Object::Introspection->invoke >>, but
+runs the function on a thread of a shared pool and returns right away with a
+C<Glib::Object::Introspection::Future>:
+
+  my $future = Glib::Object::Introspection->invoke_async(
+    'Foo', undef, 'compute_checksum', $data);
+  $future->on_ready (sub {
+    my ($future) = @_;
+    my $checksum = eval { $future->get };
+    ...
+  });
+
+The arguments are converted on the calling thread; private copies of them are
+kept until the function returns.  The return value and the output arguments
+are converted, and the future is resolved, on the main context that was the
+thread-default one when C<invoke_async> was called, so a main loop has to be
+running on it for this to happen.  The future has these methods:
+
+=over
+
+=item * C<is_ready> tells whether the function has returned.
+
+=item * C<on_ready ($code)> calls C<$code> with the future once it is ready.
+
+=item * C<wait> iterates the default main context until the future is ready,
+so it only helps for calls made while that was the thread-default one.
+
+=item * C<get> waits and then returns what C<invoke> would have returned, or
+throws the C<Glib::Error> the function reported.
+
+=back
+
+Functions that take callbacks and functions that take ownership of objects,
+structures or containers passed to them cannot be invoked like this.
+Callbacks that the function reaches anyway, like Perl implementations of
+virtual functions, are run on that main context while the pool thread waits
+for them, as described in L</Callbacks from other threads>; this is enabled
+for as long as calls made with C<invoke_async> are outstanding.
+
+=head2 C<< Glib::Object::Introspection->invoke_async_bulk >>
+
+To run the same asynchronous operation over many inputs, like querying
+information on thousands of files, without creating a callback for each of
+them, use C<< Glib::Object::Introspection->invoke_async_bulk >>:
+
+  my $future = Glib::Object::Introspection->invoke_async_bulk(
+    'Gio', 'File', 'query_info_async',
+    [map { [$_, 'standard::size', [], 0, undef] } @files],
+    max_in_flight => 16,
+    batch_size => 100,
+    on_batch => sub {
+      my ($results) = @_;
+      foreach my $result (@$results) {
+        my ($index, $error, $info) = @$result;
+        ...
+      }
+    });
+
+Each argument tuple holds the arguments of one call of the C<*_async> function
+without the callback and its data.  At most C<max_in_flight> (default: 8)
+operations run at a time, started from the main context that was the
+thread-default one when C<invoke_async_bulk> was called; the matching
+C<*_finish> function is called natively for each of them, as described in
+L</Asynchronous operations and futures>.  The results are handed to
+C<on_batch> in batches of at most C<batch_size> (default: 64), each one as an
+array reference holding the index of the argument tuple, the error or undef,
+and what the C<*_finish> function returned.  The returned future is resolved
+once all operations are complete: with their number if there is an
+C<on_batch> handler, and otherwise with an array reference of all results,
+ordered like the argument tuples.
+
+=head2 C<< Glib::Object::Introspection->invoke_parallel >>
+
+To make use of all cores for functions that only compute, like checksums or
+image scaling, C<< Glib::Object::Introspection->invoke_parallel >> calls a
+function once for each of a list of argument tuples:
+
+  my $results = Glib::Object::Introspection->invoke_parallel(
+    $basename, $namespace, $function, [[@args1], [@args2], ...])
+
+All argument tuples are converted first.  Then the calls are spread over the
+calling thread and the threads of a shared pool.  Once all of them are
+complete, the results are converted and returned as an array reference
+holding, for each tuple, an array reference of what C<invoke> would have
+returned.  If any call reports an error, the first such error is thrown.
+
+Functions that take callbacks and functions that take ownership of objects,
+structures or containers passed to them are refused.  The function must not
+lead to Perl code being run, as the calling thread is busy until all calls are
+complete.
+
+=head2 Warming up before forking
+
+Glib::Object::Introspection resolves function information, symbols, GTypes,
+enumeration tables and field information lazily and caches the results.  In a
+preforking server, each child would thus repeat this work and end up with
+private copies of the caches.  To avoid this, warm the caches in the parent
+before forking:
+
+  Glib::Object::Introspection->warm ($package_or_basename)
+  Glib::Object::Introspection->warm ($package_or_basename, [names])
+  Glib::Object::Introspection->warm ($package_or_basename, $manifest)
+
+Without a list, everything the library provides is resolved.  A list restricts
+this to the given functions, named like C<'Namespace::function'> or
+C<'function'>, using the names from the typelib and not the corrected Perl
+names.  Alternatively, you can pass a usage manifest recorded in an earlier
+run; entries for other libraries are ignored:
+
+  # in a representative run:
+  Glib::Object::Introspection->record_usage (1);
+  ...
+  my @manifest = Glib::Object::Introspection->usage_manifest;
+  # store @manifest somewhere
+
+  # in the parent of the preforking server:
+  Glib::Object::Introspection->warm ('Gtk3', \@manifest);
+
+C<record_usage> makes Glib::Object::Introspection record each function the
+first time it is invoked; C<usage_manifest> returns the recorded functions as
+array references of the form C<[$basename, $namespace, $function]>.
+
+=head2 Startup profile
+
+To find out where the time spent in C<setup> and in the C<INIT> phase goes,
+look at the startup profile:
+
+  my $profile = Glib::Object::Introspection->startup_profile ($basename);
+  my $profiles = Glib::Object::Introspection->startup_profile;
+
+For each basename, the profile contains the time in seconds spent in each
+phase (C<< $profile->{phases} >>: loading the library, walking the typelib and
+registering types, installing subs for functions, constants and accessors,
+installing generic signal marshallers, and hooking up vfuncs during C<INIT>)
+and a few counts (C<< $profile->{counts} >>: infos visited, types registered,
+subs installed, signal marshallers installed and closures created).  Without
+an argument, a hash reference mapping basenames to profiles is returned.
+
+If the environment variable C<GPERL_I11N_PROFILE> is set to a true value, the
+profiles are also printed to standard error at the end of C<INIT>, or right
+after C<setup> for libraries set up later.
+
 =head2 Overrides
 
 To override the behavior of a specific function or method, create an
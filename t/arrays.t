@@ -6,7 +6,7 @@ use strict;
 use warnings;
 use utf8;
 
-plan tests => 92;
+plan tests => 93;
 
 ok (Regress::test_strv_in ([ '1', '2', '3' ]));
 
@@ -180,6 +180,20 @@ SKIP: {
   $obj->emit_sig_with_array_len_prop ();
 }
 
+SKIP: {
+  skip 'emit_sig_with_array_len_prop', 1
+    unless check_gi_version (1, 47, 92);
+  my $obj = Regress::TestObj->constructor ();
+  my $n_emissions = 0;
+  $obj->signal_connect ('sig-with-array-len-prop' => sub { $n_emissions++ });
+  my $n_closures = Glib::Object::Introspection->_get_n_perl_callback_closures;
+  $obj->emit_sig_with_array_len_prop () for 1..10;
+  is_deeply ([$n_emissions,
+              Glib::Object::Introspection->_get_n_perl_callback_closures],
+             [10, $n_closures],
+             'generic signal marshaller does not create closures per emission');
+}
+
 # -----------------------------------------------------------------------------
 
 SKIP: {
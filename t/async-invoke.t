@@ -0,0 +1,89 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 16;
+
+my $future = Glib::Object::Introspection->invoke_async (
+  'Regress', undef, 'test_int', 42);
+isa_ok ($future, 'Glib::Object::Introspection::Future');
+is ($future->get, 42);
+ok ($future->is_ready);
+
+# The args are copied, so changing them right away must not matter.
+my $string = Regress::test_utf8_const_return ();
+$future = Glib::Object::Introspection->invoke_async (
+  'Regress', undef, 'test_utf8_inout', $string);
+$string = 'changed';
+my $ready = 0;
+$future->on_ready (sub { $ready++ });
+is ($future->get, Regress::test_utf8_nonconst_return ());
+is ($ready, 1);
+
+my ($one, $two) = Glib::Object::Introspection->invoke_async (
+  'Regress', undef, 'test_utf8_out_out')->get;
+is_deeply ([$one, $two], ['first', 'second']);
+
+my $obj = Regress::TestObj->constructor;
+$future = Glib::Object::Introspection->invoke_async (
+  'Regress', 'TestObj', 'instance_method', $obj);
+undef $obj;
+is ($future->get, -1);
+
+SKIP: {
+  skip 'gerror', 1 unless defined &GI::gerror;
+  $future = Glib::Object::Introspection->invoke_async (
+    'GIMarshallingTests', undef, 'gerror');
+  eval { $future->get };
+  isa_ok ($@, 'Glib::Error');
+}
+
+eval {
+  Glib::Object::Introspection->invoke_async (
+    'Regress', undef, 'test_callback', sub { 1 });
+};
+like ($@, qr/takes a callback/);
+
+# *_async functions called without a callback return a future that the
+# matching *_finish function resolves.
+SKIP: {
+  skip 'async test functions', 4
+    unless defined &Regress::test_function_thaw_async;
+  $future = Regress::test_function_async (0, undef);
+  isa_ok ($future, 'Glib::Object::Introspection::Future');
+  Regress::test_function_thaw_async ();
+  ok ($future->get);
+
+  my $obj = Regress::TestObj->constructor;
+  $future = $obj->function_async (0, undef);
+  Regress::TestObj::function_thaw_async ($obj);
+  ok ($future->get);
+
+  # An explicit undef means that nobody is notified.
+  my @results = Regress::test_function_async (0, undef, undef);
+  is (scalar @results, 0);
+  Regress::test_function_thaw_async ();
+}
+
+SKIP: {
+  skip 'async test functions', 3
+    unless defined &Regress::test_function_thaw_async;
+  my $obj = Regress::TestObj->constructor;
+  my @batches;
+  my $future = Glib::Object::Introspection->invoke_async_bulk (
+    'Regress', 'TestObj', 'function_async', [map { [$obj, 0, undef] } 1..5],
+    max_in_flight => 2,
+    batch_size => 2,
+    on_batch => sub { push @batches, [map { $_->[0] } @{$_[0]}] });
+  my $context = Glib::MainContext->default;
+  until ($future->is_ready) {
+    $context->iteration (0);
+    Regress::TestObj::function_thaw_async ($obj);
+  }
+  is ($future->get, 5);
+  is_deeply ([sort { $a <=> $b } map { @$_ } @batches], [0..4]);
+  ok (!grep { @$_ > 2 } @batches);
+}
@@ -5,7 +5,7 @@ BEGIN { require './t/inc/setup.pl' };
 use strict;
 use warnings;
 
-plan tests => 27;
+plan tests => 34;
 
 my $data = 42;
 my $result = 23;
@@ -28,3 +28,43 @@ is (Regress::test_callback_thaw_async (), $result);
 my $obj = Regress::TestObj->new_callback ($callback, $data);
 isa_ok ($obj, 'Regress::TestObj');
 is (Regress::test_callback_thaw_notifications (), 23);
+
+# Closures for call-scoped callbacks are recycled.
+{
+  Regress::test_callback ($empty_callback);
+  my $n_closures = Glib::Object::Introspection->_get_n_perl_callback_closures;
+  Regress::test_callback ($empty_callback) for 1..10;
+  Regress::test_callback (sub { return 1 }) for 1..10;
+  is (Glib::Object::Introspection->_get_n_perl_callback_closures, $n_closures);
+}
+
+# Async callbacks are released once they have been invoked.
+{
+  my $before = Glib::Object::Introspection->async_callback_counts;
+  Regress::test_callback_async ($empty_callback, $data);
+  is (Glib::Object::Introspection->async_callback_counts->{live},
+      $before->{live} + 1);
+  Regress::test_callback_thaw_async ();
+  my $after = Glib::Object::Introspection->async_callback_counts;
+  is ($after->{live}, $before->{live});
+  is ($after->{released}, $before->{released} + 1);
+}
+
+# Dispatching of callbacks from foreign threads does not affect callbacks
+# invoked on our own thread.
+{
+  Glib::Object::Introspection->dispatch_foreign_thread_callbacks (1);
+  is (Regress::test_callback ($empty_callback), $result);
+  Glib::Object::Introspection->dispatch_foreign_thread_callbacks (0);
+}
+
+# Plain calls and callbacks return only their own results, also after other
+# calls have left their state on the C stack.
+{
+  Regress::test_int8 ($_) for 1..8;
+  Regress::test_callback_user_data ($empty_callback, $data) for 1..3;
+  my @int = Regress::test_int (7);
+  is_deeply (\@int, [7]);
+  my @callback = Regress::test_callback ($empty_callback);
+  is_deeply (\@callback, [$result]);
+}
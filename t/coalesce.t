@@ -0,0 +1,68 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 11;
+
+my $coalesced = Glib::Object::Introspection::Coalesced->new (sub {});
+isa_ok ($coalesced, 'Glib::Object::Introspection::Coalesced');
+
+eval { Glib::Object::Introspection::Coalesced->new ('handler') };
+like ($@, qr/must be a code reference/);
+
+eval { Regress::test_callback ($coalesced) };
+like ($@, qr/cannot be coalesced/);
+
+{
+  my $obj = Regress::TestObj->constructor ();
+  eval { $obj->signal_connect ('sig-with-int64-prop' => $coalesced) };
+  like ($@, qr/cannot be coalesced/, 'refused when connected');
+}
+
+sub run_pending {
+  my $context = Glib::MainContext->default;
+  $context->iteration (0) while $context->pending;
+}
+
+SKIP: {
+  skip 'emit_sig_with_array_len_prop', 5
+    unless check_gi_version (1, 47, 92);
+
+  my $obj = Regress::TestObj->constructor ();
+  my @batches;
+  $obj->signal_connect ('sig-with-array-len-prop' =>
+    Glib::Object::Introspection::Coalesced->new (sub {
+      push @batches, $_[0];
+    }));
+  $obj->emit_sig_with_array_len_prop () for 1..10;
+  is (scalar @batches, 0, 'nothing is delivered during the emissions');
+  run_pending ();
+  is (scalar @batches, 1, 'all emissions are delivered at once');
+  is (scalar @{$batches[0]}, 10);
+  is_deeply ($batches[0][0], [$obj, [0, 1, 2, 3, 4], 5]);
+
+  $obj = Regress::TestObj->constructor ();
+  @batches = ();
+  $obj->signal_connect ('sig-with-array-len-prop' =>
+    Glib::Object::Introspection::Coalesced->new (sub {
+      push @batches, scalar @{$_[0]};
+    }, max_events => 4));
+  $obj->emit_sig_with_array_len_prop () for 1..10;
+  run_pending ();
+  is_deeply (\@batches, [4, 4, 2], 'batches are limited by max_events');
+}
+
+{
+  my $obj = Regress::TestObj->constructor ();
+  my @batches;
+  $obj->signal_connect ('test' =>
+    Glib::Object::Introspection::Coalesced->new (sub {
+      push @batches, $_[0];
+    }));
+  $obj->signal_emit ('test');
+  is (scalar @batches, 1, 'other signals are delivered per event');
+  is_deeply ($batches[0], [[$obj]]);
+}
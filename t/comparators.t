@@ -0,0 +1,52 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 7;
+
+my $by_int = Glib::Object::Introspection::Comparator->new (
+  property => 'int', compare => 'numeric');
+isa_ok ($by_int, 'Glib::Object::Introspection::Comparator');
+
+eval { Glib::Object::Introspection::Comparator->new (compare => 'numeric') };
+like ($@, qr/either a property or a key function/);
+
+eval { Regress::test_callback ($by_int) };
+like ($@, qr/can only be used for callbacks/);
+
+SKIP: {
+  my $have_gio = eval {
+    Glib::Object::Introspection->setup (
+      basename    => 'Gio',
+      version     => '2.0',
+      package     => 'Glib::IO');
+    1;
+  };
+  skip 'Glib::IO::ListStore', 4
+    unless $have_gio && Glib::IO::ListStore->can ('sort');
+
+  my $store = Glib::IO::ListStore->new ('Regress::TestObj');
+  foreach my $i (3, 10, 1, 2) {
+    $store->append (Regress::TestObj->new (int => $i, string => "s$i"));
+  }
+  my $ints = sub {
+    [map { $store->get_item ($_)->get ('int') } 0 .. $store->get_n_items - 1]
+  };
+
+  $store->sort ($by_int);
+  is_deeply ($ints->(), [1, 2, 3, 10]);
+
+  $store->sort (Glib::Object::Introspection::Comparator->new (
+    property => 'string'));
+  is_deeply ($ints->(), [1, 10, 2, 3]);
+
+  my $n_keys = 0;
+  $store->sort (Glib::Object::Introspection::Comparator->new (
+    key => sub { $n_keys++; $_[0]->get ('int') },
+    compare => 'numeric', reverse => 1));
+  is_deeply ($ints->(), [10, 3, 2, 1]);
+  is ($n_keys, 4, 'keys are computed once per element');
+}
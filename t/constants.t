@@ -6,7 +6,7 @@ use strict;
 use warnings;
 use utf8;
 
-plan tests => 6;
+plan tests => 11;
 
 is (GI::CONSTANT_NUMBER, 42);
 is (GI::CONSTANT_UTF8, 'const ♥ utf8');
@@ -15,3 +15,27 @@ is (Regress::INT_CONSTANT, 4422);
 delta_ok (Regress::DOUBLE_CONSTANT, 44.22);
 is (Regress::STRING_CONSTANT, "Some String");
 is (Regress::Mixed_Case_Constant, 4423);
+
+BEGIN {
+  Glib::Object::Introspection->_install_constants (
+    'Regress', { INT_CONSTANT => 'Inlined::INT_CONSTANT',
+                 STRING_CONSTANT => 'Inlined::STRING_CONSTANT' });
+}
+is (Inlined::INT_CONSTANT, 4422);
+is (Inlined::STRING_CONSTANT, "Some String");
+is (prototype ('Inlined::INT_CONSTANT'), '');
+
+SKIP: {
+  my $have_gio = eval {
+    Glib::Object::Introspection->setup (
+      basename => 'Gio',
+      version => '2.0',
+      package => 'Glib::IO',
+      inline_constants => 1);
+    1;
+  };
+  skip 'Need Gio', 2 unless $have_gio;
+  is (Glib::IO::FILE_ATTRIBUTE_STANDARD_NAME (), 'standard::name');
+  is (prototype ('Glib::IO::FILE_ATTRIBUTE_STANDARD_NAME'), '',
+      'setup installs constant subs');
+}
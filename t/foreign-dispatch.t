@@ -0,0 +1,58 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 4;
+
+# Functions invoked with invoke_async run on a pool thread, so the Perl
+# implementations of vfuncs they call are reached from that thread and have to
+# be dispatched to ours.
+
+my @received;
+
+{
+  package ThreadedImplementation;
+  use Glib::Object::Subclass 'GI::Object';
+  sub METHOD_INT8_IN {
+    my ($self, $int8) = @_;
+    push @received, $int8;
+  }
+  sub METHOD_INT8_OUT {
+    return 42;
+  }
+}
+
+sub run_pending {
+  my $context = Glib::MainContext->default;
+  $context->iteration (0) while $context->pending;
+}
+
+my $obj = ThreadedImplementation->new;
+
+# The pool thread waits for the out value.
+my $future = Glib::Object::Introspection->invoke_async (
+  'GIMarshallingTests', 'Object', 'method_int8_out', $obj);
+is ($future->get, 42, 'blocking invocations hand back values');
+
+# Invocations without results are queued and run later.
+$future = Glib::Object::Introspection->invoke_async (
+  'GIMarshallingTests', 'Object', 'method_int8_in', $obj, 23);
+$future->get;
+run_pending ();
+is_deeply (\@received, [23], 'detached invocations run on our thread');
+
+@received = ();
+my @futures = map {
+  Glib::Object::Introspection->invoke_async (
+    'GIMarshallingTests', 'Object', 'method_int8_in', $obj, $_);
+} 1..8;
+$_->get for @futures;
+run_pending ();
+is_deeply ([sort { $a <=> $b } @received], [1..8],
+           'all detached invocations run');
+
+# Once the calls are complete, callbacks on our own thread are not affected.
+is (Regress::test_callback (sub { 42 }), 42);
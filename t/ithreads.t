@@ -0,0 +1,53 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan skip_all => 'Need a perl with ithreads' unless $Config{useithreads};
+plan tests => 7;
+
+require threads;
+
+# Each interpreter works with its own module state, and callbacks are invoked
+# in the interpreter that created them.
+my @results = threads->create (sub {
+  my $obj = Regress::TestObj->constructor;
+  return (
+    ref $obj,
+    Regress::test_callback_user_data (sub { return $_[0] + 1 }, 22),
+    Regress::test_callback (sub { 42 }),
+  );
+})->join;
+is_deeply (\@results, ['Regress::TestObj', 23, 42]);
+
+is (Regress::test_callback_user_data (sub { return $_[0] + 1 }, 22), 23);
+isa_ok (Regress::TestObj->constructor, 'Regress::TestObj');
+
+my @more = map { $_->join } map {
+  my $n = $_;
+  threads->create (sub { Regress::test_callback (sub { $n }) });
+} 1..4;
+is_deeply (\@more, [1..4]);
+
+# Vfunc implementations run in the interpreter that set up their class, also
+# when classes of several interpreters implement the same vfunc.
+{
+  package MainImplementation;
+  use Glib::Object::Subclass 'GI::Object';
+  sub METHOD_INT8_OUT { return 42 }
+}
+
+is (MainImplementation->new->method_int8_out, 42);
+my $thread_result = threads->create (sub {
+  eval q{
+    package ThreadImplementation;
+    use Glib::Object::Subclass 'GI::Object';
+    sub METHOD_INT8_OUT { return 23 }
+    1;
+  } or die $@;
+  return ThreadImplementation->new->method_int8_out;
+})->join;
+is ($thread_result, 23);
+is (MainImplementation->new->method_int8_out, 42);
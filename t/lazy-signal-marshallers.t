@@ -0,0 +1,52 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+my $have_gio = eval {
+  Glib::Object::Introspection->setup (
+    basename => 'Gio',
+    version => '2.0',
+    package => 'Glib::IO',
+    use_generic_signal_marshaller_for => [
+      'all',
+      ['Glib::IO::Cancellable', 'cancelled', sub { return ('converted') }],
+    ]);
+  1;
+};
+plan $have_gio ? (tests => 7) : (skip_all => 'Need Gio');
+
+sub n_closures {
+  Glib::Object::Introspection->_get_n_perl_callback_closures;
+}
+
+# Explicitly configured marshallers are kept, including their converters.
+my $cancellable = Glib::IO::Cancellable->new;
+my @received;
+$cancellable->signal_connect ('cancelled' => sub { @received = @_ });
+$cancellable->cancel;
+is_deeply (\@received, ['converted'], 'explicit converters are kept');
+
+# The other signals get marshallers when handlers are connected, and signals
+# with the same signature share one.
+my $app = Glib::IO::Application->new ('org.gnome.PerlI11nTest', []);
+my $n_closures = n_closures ();
+my $n_activations = 0;
+$app->signal_connect ('activate' => sub { $n_activations++ });
+is (n_closures (), $n_closures + 1, 'a marshaller is installed on connect');
+$app->signal_connect ('activate' => sub { $n_activations++ });
+is (n_closures (), $n_closures + 1, 'it is installed only once');
+$app->signal_connect ('startup' => sub {});
+is (n_closures (), $n_closures + 1,
+    'signals with the same signature share a marshaller');
+$app->signal_emit ('activate');
+is ($n_activations, 2);
+
+my $store = Glib::IO::ListStore->new ('Glib::IO::Cancellable');
+$store->signal_connect ('items-changed' => sub {});
+is (n_closures (), $n_closures + 2, 'other signatures get their own');
+
+eval { $app->signal_connect ('no-such-signal' => sub {}) };
+like ($@, qr/no-such-signal/, 'unknown signals are still reported');
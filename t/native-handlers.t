@@ -0,0 +1,63 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 10;
+
+my $max = Glib::Object::Introspection->native_function (
+  'GIMarshallingTests', undef, 'int_return_max');
+isa_ok ($max, 'Glib::Object::Introspection::NativeFunction');
+is ($max->(), 0x7fffffff, 'native functions can be called from Perl');
+
+eval { Glib::Object::Introspection->native_function (
+  'GIMarshallingTests', undef, 'no_such_function') };
+like ($@, qr/no_such_function/);
+
+is (Regress::test_callback ($max), 0x7fffffff,
+    'native functions can be passed as callbacks');
+
+my $int_in = Glib::Object::Introspection->native_function (
+  'GIMarshallingTests', undef, 'int_in_max');
+eval { Regress::test_callback ($int_in) };
+like ($@, qr/does not match the signature/);
+
+my $set_bare = Glib::Object::Introspection->native_function (
+  'Regress', 'TestObj', 'set_bare');
+
+{
+  my $obj = Regress::TestObj->constructor ();
+  my $other = Regress::TestObj->constructor ();
+  my $id = Glib::Object::Introspection->signal_connect_native (
+    $obj, 'test', $set_bare, data => $other);
+  ok ($id, 'native signal handlers can be connected');
+  $obj->signal_emit ('test');
+  is ($obj->get ('bare'), $other, 'the data is passed to the handler');
+}
+
+{
+  my $obj = Regress::TestObj->constructor ();
+  my $other = Regress::TestObj->constructor ();
+  Glib::Object::Introspection->signal_connect_native (
+    $obj, 'test', $set_bare, data => $other, swapped => 1);
+  $obj->signal_emit ('test');
+  is ($other->get ('bare'), $obj, 'instance and data can be swapped');
+}
+
+{
+  my $obj = Regress::TestObj->constructor ();
+  eval { Glib::Object::Introspection->signal_connect_native (
+    $obj, 'test', $int_in) };
+  like ($@, qr/does not match the signature of signal test/);
+}
+
+{
+  my $obj = Regress::TestObj->constructor ();
+  my $wi = Regress::TestWi8021x->new;
+  eval { Glib::Object::Introspection->signal_connect_native (
+    $obj, 'test', $set_bare, data => $wi, swapped => 1) };
+  like ($@, qr/does not match the signature of signal test/,
+        'object types are checked');
+}
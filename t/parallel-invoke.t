@@ -0,0 +1,41 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 6;
+
+my $results = Glib::Object::Introspection->invoke_parallel (
+  'Regress', undef, 'test_int', [map { [$_] } 1..100]);
+is_deeply ($results, [map { [$_] } 1..100]);
+
+$results = Glib::Object::Introspection->invoke_parallel (
+  'Regress', undef, 'test_utf8_out_out', [[], []]);
+is_deeply ($results, [['first', 'second'], ['first', 'second']]);
+
+is_deeply (Glib::Object::Introspection->invoke_parallel (
+             'Regress', undef, 'test_int', []),
+           []);
+
+eval {
+  Glib::Object::Introspection->invoke_parallel (
+    'Regress', undef, 'test_int', [[1], []]);
+};
+like ($@, qr/too few/);
+
+eval {
+  Glib::Object::Introspection->invoke_parallel (
+    'Regress', undef, 'test_callback', [[sub { 1 }]]);
+};
+like ($@, qr/takes a callback/);
+
+SKIP: {
+  skip 'gerror', 1 unless defined &GI::gerror;
+  eval {
+    Glib::Object::Introspection->invoke_parallel (
+      'GIMarshallingTests', undef, 'gerror', [[], []]);
+  };
+  isa_ok ($@, 'Glib::Error');
+}
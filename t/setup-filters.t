@@ -0,0 +1,51 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 18;
+
+my ($select_name, $select_member) =
+  Glib::Object::Introspection::_create_name_selectors (
+    ['File', 'Settings::get_*', qr/^content_type_/],
+    ['File::read_async', qr/_finish$/]);
+
+ok ($select_name->('File'));
+ok ($select_name->('Settings'));
+ok ($select_name->('content_type_get_icon'));
+ok (!$select_name->('FileInfo'));
+
+ok ($select_member->('File', 'new_for_path'));
+ok (!$select_member->('File', 'read_async'));
+ok (!$select_member->('File', 'read_finish'));
+ok ($select_member->('Settings', 'get_boolean'));
+ok (!$select_member->('Settings', 'set_boolean'));
+
+($select_name, $select_member) =
+  Glib::Object::Introspection::_create_name_selectors (undef, ['File*']);
+ok (!$select_name->('FileInfo'));
+ok ($select_member->('Settings', 'set_boolean'));
+
+is (scalar Glib::Object::Introspection::_create_name_selectors (), undef);
+
+SKIP: {
+  my $have_gio = eval {
+    Glib::Object::Introspection->setup (
+      basename => 'Gio',
+      version => '2.0',
+      package => 'Glib::IO',
+      only => ['File', 'FileInfo', 'content_type_*'],
+      exclude => [qr/_async$/, 'FileInfo::set_*']);
+    1;
+  };
+  skip 'Need Gio', 6 unless $have_gio;
+  ok (defined &Glib::IO::File::new_for_path);
+  ok (!defined &Glib::IO::File::read_async);
+  ok (defined &Glib::IO::content_type_guess);
+  ok (!defined &Glib::IO::FileInfo::set_name);
+  ok (Glib::IO::FileInfo->isa ('Glib::Object'), 'selected types are registered');
+  ok (!Glib::IO::Application->isa ('Glib::Object'),
+      'other types are not registered');
+}
@@ -0,0 +1,41 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 9;
+
+eval { Glib::Object::Introspection->_use_generic_signal_marshaller_for (
+  'Regress::TestObj', 'sig-with-obj', [2]) };
+like ($@, qr/invalid arg position/);
+
+eval { Glib::Object::Introspection->_use_generic_signal_marshaller_for (
+  'Regress::TestObj', 'sig-with-obj', [[1, field => 'nope']]) };
+like ($@, qr/has no field 'nope'/);
+
+eval { Glib::Object::Introspection->_use_generic_signal_marshaller_for (
+  'Regress::TestObj', 'sig-with-obj', [[1, 'field']]) };
+like ($@, qr/name => value pairs/);
+
+eval { Glib::Object::Introspection->_use_generic_signal_marshaller_for (
+  'Regress::TestObj', 'sig-with-obj', [[1, package => 'Regress::TestObj']]) };
+like ($@, qr/not an enum or flags type/, 'objects are not reblessed');
+
+eval { Glib::Object::Introspection->_use_generic_signal_marshaller_for (
+  'Regress::TestObj', 'sig-with-int64-prop',
+  [0, [1, package => 'Regress::TestEnum']]) };
+is ($@, '', 'enum conversions are accepted');
+
+Glib::Object::Introspection->_use_generic_signal_marshaller_for (
+  'Regress::TestObj', 'sig-with-obj', [1, 0]);
+
+my $obj = Regress::TestObj->constructor ();
+my @received;
+$obj->signal_connect ('sig-with-obj' => sub { @received = @_ }, 'data');
+$obj->emit_sig_with_obj ();
+is (scalar @received, 3, 'bare positions reach the handler');
+is ($received[0]->get ('int'), 3);
+is ($received[1], $obj, 'args are reordered');
+is ($received[2], 'data', 'the data is kept');
@@ -0,0 +1,21 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 7;
+
+my $profile = Glib::Object::Introspection->startup_profile ('Regress');
+ok (exists $profile->{phases}{load_library});
+ok (exists $profile->{phases}{register_types});
+ok (exists $profile->{phases}{install_functions});
+cmp_ok ($profile->{counts}{infos_visited}, '>', 0);
+cmp_ok ($profile->{counts}{types_registered}, '>', 0);
+cmp_ok ($profile->{counts}{subs_installed}, '>', 0);
+
+my $profiles = Glib::Object::Introspection->startup_profile;
+is_deeply ([sort grep { $_ eq 'GIMarshallingTests' || $_ eq 'Regress' }
+                 keys %$profiles],
+           ['GIMarshallingTests', 'Regress']);
@@ -0,0 +1,40 @@
+#!/usr/bin/env perl
+
+BEGIN { require './t/inc/setup.pl' };
+
+use strict;
+use warnings;
+
+plan tests => 9;
+
+Glib::Object::Introspection->record_usage (1);
+is (Regress::test_int8 (-127), -127);
+Glib::Object::Introspection->record_usage (0);
+
+my @manifest = Glib::Object::Introspection->usage_manifest;
+my @test_int8 = grep { $_->[2] eq 'test_int8' } @manifest;
+is (scalar @test_int8, 1);
+is_deeply ($test_int8[0], ['Regress', undef, 'test_int8']);
+
+# Functions that were warmed before are recorded on their first use, too.
+Glib::Object::Introspection->warm ('Regress', ['test_int16']);
+Glib::Object::Introspection->record_usage (1);
+Regress::test_int16 (1) for 1..2;
+Glib::Object::Introspection->record_usage (0);
+is (scalar (grep { $_->[2] eq 'test_int16' }
+              Glib::Object::Introspection->usage_manifest), 1);
+
+Glib::Object::Introspection->warm ('Regress', \@manifest);
+Glib::Object::Introspection->warm ('Regress', ['test_boolean', 'TestObj::new']);
+ok (Regress::test_boolean (1));
+isa_ok (Regress::TestObj->new (Regress::TestObj->constructor),
+        'Regress::TestObj');
+
+Glib::Object::Introspection->warm ('GI');
+is (GI::int8_return_max (), 127);
+
+eval { Glib::Object::Introspection->warm ('Regress', ['no_such_function']) };
+like ($@, qr/no_such_function/);
+
+eval { Glib::Object::Introspection->warm ('NoSuchLibrary') };
+like ($@, qr/NoSuchLibrary/);